@@ -2,10 +2,22 @@
 layout(location = 0) in vec2 vertLocationIn;
 layout(location = 1) in vec2 vertTexCoordIn;
 
-uniform int currentTile;
-uniform int tiles; // the number of horizonital and vertical tiles
+layout(location = 5) in int currentTile; // per instance
+
+// set per material, through a uniform buffer
+layout(std140) uniform MaterialParams
+{
+	int tiles; // the number of horizonital and vertical tiles
+};
+
+layout(location = 2) in mat3 modelMat; // per instance, takes 2 through 4
+
+// the same for everything drawn in a frame
+layout(std140) uniform Camera
+{
+	mat3 viewMat;
+};
 
-uniform mat3 MVPmat;
 uniform float renderOrder;
 
 out vec2 fragTexCoord;
@@ -13,8 +25,8 @@ out vec2 fragTexCoord;
 void main()
 {
 	
-	gl_Position.xyw = MVPmat * vec3(vertLocationIn, 1.f);
-	gl_Position.z = float(renderOrder - 256) / 256;
+	gl_Position.xyw = viewMat * modelMat * vec3(vertLocationIn, 1.f);
+	gl_Position.z = 1.f - (renderOrder + .5f) / 128.f; // 0 to 255 back to front, over the whole depth range
 	
 	// calculate the texture coordinates
 	int row = currentTile / tiles;
@@ -2,7 +2,14 @@
 layout(location = 0) in vec2 vertLocationIn;
 layout(location = 1) in vec2 vertTexCoordIn;
 
-uniform mat3 MVPmat;
+layout(location = 2) in mat3 modelMat; // per instance, takes 2 through 4
+
+// the same for everything drawn in a frame
+layout(std140) uniform Camera
+{
+	mat3 viewMat;
+};
+
 uniform float renderOrder;
 
 out vec2 fragTexCoord;
@@ -10,8 +17,8 @@ out vec2 fragTexCoord;
 void main()
 {
 	
-	gl_Position.xyw = MVPmat * vec3(vertLocationIn, 1.f);
-	gl_Position.z = float(renderOrder - 256) / 256;
+	gl_Position.xyw = viewMat * modelMat * vec3(vertLocationIn, 1.f);
+	gl_Position.z = 1.f - (renderOrder + .5f) / 128.f; // 0 to 255 back to front, over the whole depth range
 	
 	fragTexCoord = vertTexCoordIn;
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform vec4 color;
+in vec4 color;
 
 out vec4 fragColor;
 
@@ -1,12 +1,21 @@
 #version 330 core
 
 layout(location = 0) in vec2 vert_pos;
+layout(location = 1) in vec4 vert_color; // RGBA8, normalized
 
-uniform mat3 MVPmat;
+// the same for everything drawn in a frame
+layout(std140) uniform Camera
+{
+	mat3 viewMat;
+};
+
+out vec4 color;
 
 void main()
 {
-	gl_Position.xyz = MVPmat * vec3(vert_pos, 1.f);
+	gl_Position.xyz = viewMat * vec3(vert_pos, 1.f);
 	gl_Position.z = 0.f;
 	gl_Position.w = 1.f;
+
+	color = vert_color;
 }
@@ -1,11 +1,10 @@
 #version 330 core
 
 in vec2 fragUV;
-
+flat in vec4 glyphColor;
+flat in float glyphCutoff;
 
 uniform sampler2D tex;
-uniform vec4 forgroundColor = vec4(1.f, 0.f, 0.f, 1.f);
-uniform float cutoff;
 
 out vec4 fragColor;
 
@@ -13,13 +12,13 @@ void main()
 {
 	float col = texture(tex, vec2(fragUV.x, fragUV.y)).r;
 
-	if(col < cutoff)
+	if(col < glyphCutoff)
 	{
 		discard;
 	}
 	else
 	{
-		fragColor = forgroundColor;
+		fragColor = glyphColor;
 	}
 }
 
@@ -1,18 +1,21 @@
 #version 330 core
 
-layout(location = 0) in vec2 location;
+layout(location = 0) in vec3 location; // through the text box's transform already, with w last
 layout(location = 1) in vec2 texCoords;
-
-uniform mat3 viewMat;
+layout(location = 2) in vec4 color;		// RGBA8, normalized
+layout(location = 3) in float cutoff;
 
 out vec2 fragUV;
+flat out vec4 glyphColor;
+flat out float glyphCutoff;
 
 void main()
 {
 
-	gl_Position.xyw = viewMat * vec3(location, 1.f);
+	gl_Position.xyw = location;
 	gl_Position.z = 0.f;
 
 	fragUV = texCoords;
+	glyphColor = color;
+	glyphCutoff = cutoff;
 }
-
@@ -0,0 +1,50 @@
+#version 330 core
+
+// FXAA over the resolved scene, in the style of Timothy Lottes' original: find how strong and which way the
+// edge through a pixel runs from its neighbours' luma, then blend along it.
+
+uniform sampler2D textures[32];
+
+in vec2 fragUV;
+
+out vec4 fragColor;
+
+const float spanMax = 8.f;			 // how far along an edge it looks, in pixels
+const float reduceMultiplier = 1.f / 8.f;
+const float reduceMin = 1.f / 128.f; // keeps flat areas from blending with themselves
+
+const vec3 lumaWeights = vec3(.299f, .587f, .114f);
+
+void main()
+{
+	vec2 texel = 1.f / vec2(textureSize(textures[0], 0));
+	
+	float lumaNW = dot(texture(textures[0], fragUV + vec2(-1.f, -1.f) * texel).rgb, lumaWeights);
+	float lumaNE = dot(texture(textures[0], fragUV + vec2(+1.f, -1.f) * texel).rgb, lumaWeights);
+	float lumaSW = dot(texture(textures[0], fragUV + vec2(-1.f, +1.f) * texel).rgb, lumaWeights);
+	float lumaSE = dot(texture(textures[0], fragUV + vec2(+1.f, +1.f) * texel).rgb, lumaWeights);
+	vec3 colorM = texture(textures[0], fragUV).rgb;
+	float lumaM = dot(colorM, lumaWeights);
+	
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+	
+	// across the edge is where luma changes most, so along it is perpendicular to that
+	vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+	
+	float directionReduce =
+		max((lumaNW + lumaNE + lumaSW + lumaSE) * (.25f * reduceMultiplier), reduceMin);
+	float scale = 1.f / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+	direction = clamp(direction * scale, vec2(-spanMax), vec2(spanMax)) * texel;
+	
+	vec3 colorA = .5f * (
+		texture(textures[0], fragUV + direction * (1.f / 3.f - .5f)).rgb +
+		texture(textures[0], fragUV + direction * (2.f / 3.f - .5f)).rgb);
+	vec3 colorB = colorA * .5f + .25f * (
+		texture(textures[0], fragUV + direction * -.5f).rgb +
+		texture(textures[0], fragUV + direction * .5f).rgb);
+	
+	// the wider sample went past the edge if it picked up luma from outside the neighbourhood
+	float lumaB = dot(colorB, lumaWeights);
+	fragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB, 1.f);
+}
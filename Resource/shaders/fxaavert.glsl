@@ -0,0 +1,13 @@
+#version 330 core
+
+// one triangle that covers the screen, so there's nothing to bind but an empty vertex array
+
+out vec2 fragUV;
+
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2); // (0, 0), (2, 0), (0, 2)
+	
+	gl_Position = vec4(corner * 2.f - 1.f, 0.f, 1.f);
+	fragUV = corner;
+}
@@ -0,0 +1,45 @@
+#version 330 core
+
+// drawn front to back with depth writes and no blending, so what it keeps has to be solid
+#pragma opaque
+
+// 0 is the texture library, an image a layer. 1 is the chunk's tile indices -- a texel per tile, each the
+// layer of the image that goes there.
+uniform sampler2DArray textureArrays[32];
+uniform sampler2D textures[32];
+
+in vec2 chunkCoord;
+
+out vec4 fragColor;
+
+const uint emptyTile = 65535u;
+
+void main()
+{
+	ivec2 chunkSize = textureSize(textures[1], 0);
+	vec2 tileCoord = chunkCoord * vec2(chunkSize);
+	ivec2 tile = clamp(ivec2(tileCoord), ivec2(0), chunkSize - 1);
+	
+	// the indices are normalized 16 bit, so scale them back up
+	uint index = uint(texelFetch(textures[1], tile, 0).r * 65535.f + .5f);
+	if (index == emptyTile)
+	{
+		discard;
+	}
+	
+	// images in the library have their top row first
+	vec2 UV = vec2(fract(tileCoord.x), 1.f - fract(tileCoord.y));
+	
+	// fract jumps at every tile edge, so the gradients come from the smooth coordinate instead
+	vec2 UVdx = dFdx(tileCoord) * vec2(1.f, -1.f);
+	vec2 UVdy = dFdy(tileCoord) * vec2(1.f, -1.f);
+	
+	fragColor = textureGrad(textureArrays[0], vec3(UV, float(index)), UVdx, UVdy);
+	
+	// cut out, rather than blended -- anything under it won't be drawn
+	if (fragColor.a < .5f)
+	{
+		discard;
+	}
+	fragColor.a = 1.f;
+}
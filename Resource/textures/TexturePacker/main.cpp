@@ -0,0 +1,117 @@
+// Bakes the images a world lists in its images.txt into one texture array, images.texarray next to it, so
+// the world's texture library goes up in one go instead of a file and an upload per image. Run it from the
+// Resource folder, like the game:
+//
+//     TexturePacker Worlds\default
+//
+// Run it again whenever images.txt or the images change -- the world loads the images one at a time while
+// images.texarray is older than images.txt.
+
+// before Color.h, which uses BOOST_SERIALIZATION_NVP without including it
+#include <boost/archive/xml_iarchive.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/string.hpp>
+
+#include <Color.h>
+#include <DDSImage.h>
+#include <TextureArrayFile.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	if (argc != 2) {
+		std::cout << "usage: TexturePacker <world folder>" << std::endl;
+		return -1;
+	}
+
+	path_t worldFolder = argv[1];
+
+	std::map<Color, std::string> imageToTextureAssoc;
+	try
+	{
+		std::ifstream stream{(worldFolder / "images.txt").string()};
+		boost::archive::xml_iarchive arch{stream};
+
+		arch >> boost::serialization::make_nvp("assoc", imageToTextureAssoc);
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "could not read " << worldFolder / "images.txt" << ": " << e.what() << std::endl;
+		return -1;
+	}
+
+	TextureArrayFile file;
+	auto&& header = file.header;
+	std::memcpy(header.magic, "MFTA", sizeof(header.magic));
+	header.version = TextureArrayFile::currentVersion;
+	header.numLayers = 0;
+
+	for (auto&& assoc : imageToTextureAssoc) {
+		auto&& name = assoc.second;
+
+		// more than one color can use the same image
+		if (std::find(file.names.begin(), file.names.end(), name) != file.names.end()) continue;
+
+		DDSImage image;
+		if (!DDSImage::load(path_t("textures") / (name + ".dds"), image)) {
+			std::cout << "could not load " << path_t("textures") / (name + ".dds") << std::endl;
+			return -1;
+		}
+
+		if (file.names.empty()) {
+			header.fourCC = image.fourCC;
+			header.width = image.width;
+			header.height = image.height;
+			header.numMips = image.mipMapCount;
+
+			file.levels.resize(header.numMips);
+		}
+		else if (image.fourCC != header.fourCC || image.width != header.width
+			|| image.height != header.height)
+		{
+			std::cout << name << " isn't the same size and format as " << file.names[0] << std::endl;
+			return -1;
+		}
+
+		// every layer needs every level, so the array only gets as many as the image with the fewest
+		if (image.mipMapCount < header.numMips) {
+			header.numMips = image.mipMapCount;
+			file.levels.resize(header.numMips);
+		}
+
+		// a level is every layer in turn, so this image goes on the end of each
+		size_t offset = 0;
+		for (uint32 level = 0; level < header.numMips; ++level) {
+			size_t size = DDSImage::getLevelSize(image.fourCC, image.width, image.height, level);
+
+			auto&& data = file.levels[level];
+			data.insert(data.end(), image.data.begin() + offset, image.data.begin() + offset + size);
+
+			offset += size;
+		}
+
+		file.names.push_back(name);
+		++header.numLayers;
+	}
+
+	if (file.names.empty()) {
+		std::cout << "no images in " << worldFolder / "images.txt" << std::endl;
+		return -1;
+	}
+
+	path_t outPath = worldFolder / "images.texarray";
+	if (!file.save(outPath)) {
+		std::cout << "could not write " << outPath << std::endl;
+		return -1;
+	}
+
+	std::cout << "packed " << header.numLayers << " images into " << outPath << std::endl;
+	return 0;
+}
@@ -11,7 +11,9 @@
 #include <Color.h>
 #include <TextureLibrary.h>
 #include <Renderer.h>
+#include <CameraComponent.h>
 #include <MaterialInstance.h>
+#include <MaterialSource.h>
 #include <Pawn.h>
 #include <PlayerController.h>
 #include <ModelData.h>
@@ -26,6 +28,8 @@
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 #include <boost/serialization/deque.hpp>
 #include <boost/serialization/map.hpp>
@@ -68,10 +72,7 @@ void DefaultWorld::init(const std::string& name)
 	folderLocation = std::string("Worlds\\") + name + '\\';
 	propManager.init(folderLocation + "world.json");
 
-	auto drawMaterial = std::shared_ptr<MaterialInstance>{Runtime::get().getRenderer().newMaterialInstance(
-		Runtime::get().getRenderer().getMaterialSource("boilerplate"))};
-
-	auto backgroundImages = std::shared_ptr<TextureLibrary>{Runtime::get().getRenderer().newTextureLibrary()};
+	backgroundImages = std::shared_ptr<TextureLibrary>{Runtime::get().getRenderer().newTextureLibrary()};
 
 	// Make sure a world folder was supplied.
 	if (name.empty() || name == "") {
@@ -110,11 +111,22 @@ void DefaultWorld::init(const std::string& name)
 		// load the map from the file
 		arch >> boost::serialization::make_nvp("assoc", imageToTextureAssoc);
 
-		backgroundImages->init(imageToTextureAssoc.size(), 256); // TODO: less hardcoded values
+		// TexturePacker bakes the images into one file that goes up in one go. Only load them one at a time
+		// if it hasn't been run since images.txt changed.
+		path_t packedPath = folderLocation + "images.texarray";
+		bool bisPackedCurrent = boost::filesystem::exists(packedPath)
+			&& boost::filesystem::last_write_time(packedPath)
+				>= boost::filesystem::last_write_time(folderLocation + "images.txt");
+
+		if (!bisPackedCurrent || !backgroundImages->load(packedPath)) {
+			MFLOG(Trace) << "No up to date " << packedPath << ", loading the images one at a time";
+
+			backgroundImages->init(imageToTextureAssoc.size(), 256); // TODO: less hardcoded values
 
-		// load the images to the backgroundImages textureLibrary
-		for (auto& elem : imageToTextureAssoc) {
-			backgroundImages->addImage(elem.second);
+			// load the images to the backgroundImages textureLibrary
+			for (auto& elem : imageToTextureAssoc) {
+				backgroundImages->addImage(elem.second);
+			}
 		}
 	}
 	catch (boost::archive::archive_exception& e)
@@ -127,9 +139,6 @@ void DefaultWorld::init(const std::string& name)
 		MFLOG(Error) << "ERROR ENCOUNTERED WHEN LOADING IMAGE ASSOCIATIONS. Message: " << e.what();
 	}
 
-	// set the material
-	drawMaterial->setTexture(0, backgroundImages);
-
 	MFLOG(Trace) << "Loading world " << name << "...";
 
 	/////////////////////////////////////////////////////
@@ -213,110 +222,322 @@ void DefaultWorld::init(const std::string& name)
 	MFLOG(Trace) << "Actors Loaded!";
 
 	///////////////////////////
-	// begin background loading
+	// begin background setup -- the chunks themselves are loaded around the camera once it is there
 	{
+		LOAD_PROPERTY_WITH_ERROR(propManager, "chunk.size", backgroundChunkSize);
 
-		using namespace std::string_literals;
+		chunkLoadDistance = static_cast<float>(backgroundChunkSize);
+		chunkUnloadDistance = chunkLoadDistance * 2.f;
+		uint32 numLoaderThreads = 2;
+		LOAD_PROPERTY_WITH_WARNING(propManager, "chunk.loadDistance", chunkLoadDistance, backgroundChunkSize);
+		LOAD_PROPERTY_WITH_WARNING(
+			propManager, "chunk.unloadDistance", chunkUnloadDistance, chunkLoadDistance * 2.f);
+		LOAD_PROPERTY_WITH_WARNING(propManager, "chunk.loaderThreads", numLoaderThreads, 2);
 
-		LOAD_PROPERTY_WITH_ERROR(propManager, "chunk.size", backgroundChunkSize);
+		if (chunkUnloadDistance <= chunkLoadDistance) {
+			MFLOG(Warning) << "chunk.unloadDistance has to be more than chunk.loadDistance. Using "
+						   << chunkLoadDistance * 2.f;
+
+			chunkUnloadDistance = chunkLoadDistance * 2.f;
+		}
+		if (numLoaderThreads == 0) numLoaderThreads = 1;
+
+		splitBackground();
+
+		PropertyManager chunkInfo{folderLocation + "background\\chunks.json"};
+		LOAD_PROPERTY_WITH_ERROR(chunkInfo, "count.x", numBackgroundChunks.x);
+		LOAD_PROPERTY_WITH_ERROR(chunkInfo, "count.y", numBackgroundChunks.y);
+
+		uint32 numChunks = numBackgroundChunks.x * numBackgroundChunks.y;
+		background = std::make_unique<ChunkActor* []>(numChunks);
+		backgroundStates = std::make_unique<ChunkState[]>(numChunks);
+		for (uint32 i = 0; i < numChunks; ++i) {
+			background[i] = nullptr;
+			backgroundStates[i] = ChunkState::UNLOADED;
+		}
 
-		std::vector<uint8> data;
-		uvec2 size;
-		lodepng::decode(data, size.x, size.y, folderLocation + "background.png"s);
-		numBackgroundChunks = size / backgroundChunkSize;
+		auto&& renderer = Runtime::get().getRenderer();
 
-		background = std::make_unique<ChunkActor* []>(numBackgroundChunks.x * numBackgroundChunks.y);
+		// every chunk is the same quad -- the tiles come from its tile index texture
+		chunkQuad = renderer.newModelData();
+		{
+			float chunkSize = static_cast<float>(backgroundChunkSize);
 
-		auto locations = std::vector<vec2>{backgroundChunkSize * backgroundChunkSize * 4};
-		auto UVs = std::vector<vec2>{backgroundChunkSize * backgroundChunkSize * 4};
-		auto elems = std::vector<uvec3>{backgroundChunkSize * backgroundChunkSize * 2};
+			vec2 locations[] = {vec2(0.f, 0.f), vec2(0.f, chunkSize), vec2(chunkSize, 0.f), vec2(chunkSize)};
+			vec2 UVs[] = {vec2(0.f, 0.f), vec2(0.f, 1.f), vec2(1.f, 0.f), vec2(1.f, 1.f)};
+			uvec3 elems[] = {uvec3(0, 1, 2), uvec3(1, 2, 3)};
 
-		// generate location and elem data -- all the same
-		for (uint16 yTiles = 0; yTiles < backgroundChunkSize; ++yTiles) {
-			for (uint16 xTiles = 0; xTiles < backgroundChunkSize; ++xTiles) {
-				uint32 startIndex = yTiles * backgroundChunkSize * 4 + xTiles * 4;
+			chunkQuad->init(locations, UVs, 4, elems, 2);
+		}
 
-				locations[startIndex] = vec2(xTiles, yTiles);
-				locations[startIndex + 1] = vec2(xTiles, yTiles + 1);
-				locations[startIndex + 2] = vec2(xTiles + 1, yTiles);
-				locations[startIndex + 3] = vec2(xTiles + 1, yTiles + 1);
+		tileMapSource = renderer.getMaterialSource("tilemap");
 
-				elems[yTiles * backgroundChunkSize * 2 + xTiles * 2] =
-					uvec3(startIndex, startIndex + 1, startIndex + 2);
-				elems[yTiles * backgroundChunkSize * 2 + xTiles * 2 + 1] =
-					uvec3(startIndex + 1, startIndex + 2, startIndex + 3);
+		// what goes in the index texture for each color, so the library is only asked once per color
+		auto tiles = std::make_shared<std::map<Color, uint16>>();
+		for (auto&& assoc : imageToTextureAssoc) {
+			if (auto index = backgroundImages->getImageIndex(assoc.second)) {
+				(*tiles)[assoc.first] = *index;
+			}
+			else
+			{
+				MFLOG(Error) << "Texture index not found for image: " << assoc.second;
 			}
 		}
+		colorToTile = std::move(tiles);
+
+		loadedChunkResults = std::make_shared<LoadedChunks>();
+		chunkLoaders = std::make_unique<WorkerPool>(numLoaderThreads);
+	}
+	// end background setup
+
+	MFLOG(Trace) << "World Loaded!";
+}
+
+bool DefaultWorld::update(float deltaTime)
+{
+	tickingActors(deltaTime);
+	streamBackground();
+	return true;
+}
+
+void DefaultWorld::splitBackground()
+{
+	path_t imagePath = folderLocation + "background.png";
+	path_t infoPath = folderLocation + "background\\chunks.json";
+
+	// already done, for this image and chunk size
+	if (boost::filesystem::exists(infoPath)
+		&& boost::filesystem::last_write_time(infoPath) >= boost::filesystem::last_write_time(imagePath))
+	{
+		PropertyManager info{infoPath};
+		if (info.queryValue<uint32>("size") == backgroundChunkSize) return;
+	}
+
+	MFLOG(Trace) << "Splitting " << imagePath << " into chunks...";
+
+	std::vector<uint8> data;
+	uvec2 size;
+	if (unsigned error = lodepng::decode(data, size.x, size.y, imagePath.string())) {
+		MFLOG(Fatal) << "Could not load " << imagePath << ": " << lodepng_error_text(error);
+	}
+
+	uvec2 numChunks = size / backgroundChunkSize;
+	uint32 rowSize = backgroundChunkSize * 4;
 
-		// generate UV
-		for (uint16 yChunks = 0; yChunks < numBackgroundChunks.y; ++yChunks) {
-			for (uint16 xChunks = 0; xChunks < numBackgroundChunks.x; ++xChunks) {
-				for (uint16 yTiles = 0; yTiles < backgroundChunkSize; ++yTiles) {
-					for (uint16 xTiles = 0; xTiles < backgroundChunkSize; ++xTiles) {
+	boost::filesystem::create_directories(infoPath.parent_path());
 
-						uint32 startColIndex =
-							((numBackgroundChunks.y - yChunks - 1) * numBackgroundChunks.x + xChunks) * 4
-								* backgroundChunkSize * backgroundChunkSize
-							+ ((backgroundChunkSize - yTiles - 1) * backgroundChunkSize * 4) + (4 * xTiles);
+	auto chunkData = std::vector<uint8>(backgroundChunkSize * rowSize);
 
-						Color col = Color(data[startColIndex],
-							data[startColIndex + 1],
-							data[startColIndex + 2],
-							data[startColIndex + 3]);
+	for (uint32 yChunks = 0; yChunks < numChunks.y; ++yChunks) {
+		for (uint32 xChunks = 0; xChunks < numChunks.x; ++xChunks) {
 
-						auto imageIter = imageToTextureAssoc.find(col);
+			// the image's top row is the top of the world, and chunks count up from the bottom
+			uint32 top = size.y - (yChunks + 1) * backgroundChunkSize;
+			for (uint32 row = 0; row < backgroundChunkSize; ++row) {
+				auto rowStart = data.begin() + ((top + row) * size.x + xChunks * backgroundChunkSize) * 4;
+				std::copy(rowStart, rowStart + rowSize, chunkData.begin() + row * rowSize);
+			}
+
+			auto chunkPath = getChunkPath(uvec2(xChunks, yChunks));
+			if (unsigned error = lodepng::encode(
+					chunkPath.string(), chunkData, backgroundChunkSize, backgroundChunkSize))
+			{
+				MFLOG(Error) << "Could not write " << chunkPath << ": " << lodepng_error_text(error);
+			}
+		}
+	}
+
+	// written last, so a split that didn't finish is done again
+	boost::property_tree::ptree info;
+	info.put("size", backgroundChunkSize);
+	info.put("count.x", numChunks.x);
+	info.put("count.y", numChunks.y);
+	boost::property_tree::write_json(infoPath.string(), info);
+}
+
+void DefaultWorld::streamBackground()
+{
+	if (numBackgroundChunks.x == 0 || numBackgroundChunks.y == 0) return;
 
-						// if it exists
-						if (imageIter != imageToTextureAssoc.end()) {
-							std::string imageName = imageIter->second;
+	vec2 cameraLocation = Runtime::get().getRenderer().getCurrentCamera().getWorldLocation();
+
+	// take what the loaders have finished, without holding them up while the actors are made
+	std::vector<LoadedChunk> finished;
+	{
+		std::lock_guard<std::mutex> lock{loadedChunkResults->mutex};
+		finished.swap(loadedChunkResults->chunks);
+	}
 
-							QuadUVCoords coords;
-							if (auto optCoords = backgroundImages->getUVCoords(imageName)) {
-								coords = *optCoords;
+	for (auto&& loaded : finished) {
+		finishLoadingChunk(loaded, cameraLocation);
+	}
+
+	// unload what has got too far away
+	for (size_t i = 0; i < loadedChunks.size();) {
+		uvec2 chunk = loadedChunks[i];
+		if (isChunkWithin(chunk, cameraLocation, chunkUnloadDistance)) {
+			++i;
+			continue;
+		}
+
+		uint32 index = getChunkIndex(chunk);
+		delete background[index];
+		background[index] = nullptr;
+		backgroundStates[index] = ChunkState::UNLOADED;
+
+		loadedChunks[i] = loadedChunks.back();
+		loadedChunks.pop_back();
+	}
+
+	// and start on what is close enough, only looking at the chunks around the camera
+	vec2 chunkSize = vec2(static_cast<float>(backgroundChunkSize));
+	ivec2 maxChunk = ivec2(numBackgroundChunks) - 1;
+	ivec2 first = ivec2(glm::floor((cameraLocation - chunkLoadDistance) / chunkSize));
+	ivec2 last = ivec2(glm::floor((cameraLocation + chunkLoadDistance) / chunkSize));
+	first = glm::clamp(first, ivec2(0), maxChunk);
+	last = glm::clamp(last, ivec2(0), maxChunk);
+
+	for (int32 y = first.y; y <= last.y; ++y) {
+		for (int32 x = first.x; x <= last.x; ++x) {
+			uvec2 chunk = uvec2(x, y);
+
+			if (backgroundStates[getChunkIndex(chunk)] == ChunkState::UNLOADED
+				&& isChunkWithin(chunk, cameraLocation, chunkLoadDistance))
+			{
+				startLoadingChunk(chunk);
+			}
+		}
+	}
+}
+
+void DefaultWorld::startLoadingChunk(uvec2 chunk)
+{
+	backgroundStates[getChunkIndex(chunk)] = ChunkState::LOADING;
+
+	// only copies and shared state -- the world could be gone by the time this runs
+	chunkLoaders->post([
+		chunk,
+		path = getChunkPath(chunk),
+		chunkSize = backgroundChunkSize,
+		colorToTile = this->colorToTile,
+		results = loadedChunkResults
+	]
+		{
+			LoadedChunk loaded{chunk, {}, false};
+
+			// the chunk stays LOADING until something comes back, so a failed one has to as well
+			try
+			{
+				std::vector<uint8> data;
+				uvec2 size;
+				unsigned error = lodepng::decode(data, size.x, size.y, path.string());
+
+				if (error || size != uvec2(chunkSize)) {
+					MFLOG(Warning) << "Could not load background chunk " << path << ": "
+								   << (error ? lodepng_error_text(error) : "it is the wrong size");
+					loaded.bisFailed = true;
+				}
+				else
+				{
+					loaded.tiles.resize(chunkSize * chunkSize);
+					uint32 numMissing = 0;
+
+					// the file's top row is the top of the chunk, and tiles count up from the bottom
+					for (uint32 yTiles = 0; yTiles < chunkSize; ++yTiles) {
+						for (uint32 xTiles = 0; xTiles < chunkSize; ++xTiles) {
+							uint32 colIndex = ((chunkSize - yTiles - 1) * chunkSize + xTiles) * 4;
+
+							Color col =
+								Color(data[colIndex], data[colIndex + 1], data[colIndex + 2], data[colIndex + 3]);
+
+							uint16& tile = loaded.tiles[yTiles * chunkSize + xTiles];
+
+							auto tileIter = colorToTile->find(col);
+							if (tileIter != colorToTile->end()) {
+								tile = tileIter->second;
 							}
 							else
 							{
-								MFLOG(Error) << "Texture coordinates not found for image: " << imageName;
+								tile = emptyTile;
+								++numMissing;
 							}
-
-							uint32 startTileIndex = (yTiles * backgroundChunkSize * 4) + (xTiles * 4);
-
-							UVs[startTileIndex] = coords.lowerLeft;
-							UVs[startTileIndex + 1] = coords.upperLeft;
-							UVs[startTileIndex + 2] = coords.lowerRight;
-							UVs[startTileIndex + 3] = coords.upperRight;
-						}
-						else
-						{
-							MFLOG(Warning)
-								<< "Warining: could not find image name in imageAssoc map in DefaultWorld";
 						}
 					}
-				}
 
-				auto modelData = Runtime::get().getRenderer().newModelData();
-				modelData->init(&locations[0],
-					&UVs[0],
-					backgroundChunkSize * backgroundChunkSize * 4,
-					&elems[0],
-					backgroundChunkSize * backgroundChunkSize * 2);
-
-				background[yChunks * numBackgroundChunks.x * xChunks] = new ChunkActor(
-					Transform{vec2(xChunks * backgroundChunkSize, yChunks * backgroundChunkSize)},
-					drawMaterial,
-					std::move(modelData));
+					if (numMissing != 0) {
+						MFLOG(Warning) << numMissing << " tiles in " << path
+									   << " have a color that isn't in images.txt";
+					}
+				}
 			}
-		}
+			catch (ENGException& e) // doesn't derive from std::exception publicly, so it needs its own
+			{
+				MFLOG(Warning) << "Could not load background chunk " << path << ": " << e.what();
+				loaded.tiles.clear();
+				loaded.bisFailed = true;
+			}
+			catch (std::exception& e)
+			{
+				MFLOG(Warning) << "Could not load background chunk " << path << ": " << e.what();
+				loaded.tiles.clear();
+				loaded.bisFailed = true;
+			}
+			catch (...)
+			{
+				MFLOG(Warning) << "Could not load background chunk " << path;
+				loaded.tiles.clear();
+				loaded.bisFailed = true;
+			}
+
+			std::lock_guard<std::mutex> lock{results->mutex};
+			results->chunks.push_back(std::move(loaded));
+		});
+}
+
+void DefaultWorld::finishLoadingChunk(LoadedChunk& loaded, vec2 cameraLocation)
+{
+	uint32 index = getChunkIndex(loaded.chunk);
+	assert(backgroundStates[index] == ChunkState::LOADING);
+
+	if (loaded.bisFailed) {
+		backgroundStates[index] = ChunkState::FAILED;
+		return;
 	}
-	// end background loading
 
-	MFLOG(Trace) << "World Loaded!";
+	// the camera could have moved off while it was loading
+	if (!isChunkWithin(loaded.chunk, cameraLocation, chunkUnloadDistance)) {
+		backgroundStates[index] = ChunkState::UNLOADED;
+		return;
+	}
+
+	auto&& renderer = Runtime::get().getRenderer();
+
+	auto tileTexture = std::shared_ptr<Texture>{
+		renderer.newTileIndexTexture(uvec2(backgroundChunkSize), loaded.tiles.data())};
+
+	auto chunkMaterial = std::shared_ptr<MaterialInstance>{renderer.newMaterialInstance(tileMapSource)};
+	chunkMaterial->setTexture(0, backgroundImages);
+	chunkMaterial->setTexture(1, std::move(tileTexture));
+
+	background[index] = new ChunkActor(
+		Transform{vec2(loaded.chunk * backgroundChunkSize)}, std::move(chunkMaterial), chunkQuad);
+	backgroundStates[index] = ChunkState::LOADED;
+	loadedChunks.push_back(loaded.chunk);
 }
 
-bool DefaultWorld::update(float deltaTime)
+bool DefaultWorld::isChunkWithin(uvec2 chunk, vec2 location, float distance) const
 {
-	tickingActors(deltaTime);
-	return true;
+	vec2 chunkMin = vec2(chunk * backgroundChunkSize);
+	vec2 chunkMax = chunkMin + static_cast<float>(backgroundChunkSize);
+
+	// how far outside the chunk location is on each axis -- 0 if it is inside
+	vec2 outside = glm::max(glm::max(chunkMin - location, location - chunkMax), vec2(0.f));
+	return outside.x <= distance && outside.y <= distance;
+}
+
+path_t DefaultWorld::getChunkPath(uvec2 chunk) const
+{
+	return folderLocation + "background\\" + std::to_string(chunk.x) + '_' + std::to_string(chunk.y) + ".png";
 }
 
 std::unique_ptr<ActorLocation> DefaultWorld::addActor(Actor& toAdd)
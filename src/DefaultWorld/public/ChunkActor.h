@@ -15,6 +15,9 @@ public:
 		, meshComp(*this, Transform{}, mat, data, 1)
 	{
 		setWorldTransform(trans);
+
+		// the background never moves, so the renderer only has to look at the chunks on screen
+		meshComp.setStatic(true);
 	}
 
 private:
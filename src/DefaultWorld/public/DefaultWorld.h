@@ -11,12 +11,18 @@
 #include <deque>
 #include <functional>
 #include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
 #include "ChunkActor.h"
 
 #include <Color.h>
+#include <MaterialSource.h>
+#include <WorkerPool.h>
 
 class DefaultWorld : public World
 {
@@ -42,6 +48,48 @@ public:
 		const std::function<void(float)>& tickFun) override;
 	// End World Interface
 private:
+	static const uint16 emptyTile = 0xFFFF; // the tile map shader leaves these out
+
+	enum class ChunkState : uint8
+	{
+		UNLOADED,
+		LOADING,
+		LOADED,
+		FAILED // not tried again
+	};
+
+	// a chunk's tiles, read on a loader thread
+	struct LoadedChunk
+	{
+		uvec2 chunk;
+		std::vector<uint16> tiles;
+		bool bisFailed; // it couldn't be read, and isn't tried again
+	};
+
+	// where the loader threads leave what they read -- shared, so it outlives the world if it has to
+	struct LoadedChunks
+	{
+		std::mutex mutex;
+		std::vector<LoadedChunk> chunks;
+	};
+
+	/// <summary> Cuts background.png into a file per chunk, if it hasn't been already or has changed
+	/// since. </summary>
+	void splitBackground();
+
+	/// <summary> Loads the chunks near the camera and gets rid of the ones that are far enough away.
+	/// </summary>
+	void streamBackground();
+
+	void startLoadingChunk(uvec2 chunk);
+	void finishLoadingChunk(LoadedChunk& loaded, vec2 cameraLocation);
+
+	/// <summary> If any of chunk is within distance of location, on both axes. </summary>
+	bool isChunkWithin(uvec2 chunk, vec2 location, float distance) const;
+
+	path_t getChunkPath(uvec2 chunk) const;
+	uint32 getChunkIndex(uvec2 chunk) const { return chunk.y * numBackgroundChunks.x + chunk.x; }
+
 	std::string folderLocation;
 	std::string worldName;
 
@@ -50,13 +98,28 @@ private:
 	// use a deque -- the index can be the index in it!
 	std::deque<Actor*> actors;
 
-	// array of models -- in row major order
+	// the loaded chunks, in row major order -- nullptr until they are
 	std::unique_ptr<ChunkActor* []> background;
+	std::unique_ptr<ChunkState[]> backgroundStates;
+	std::vector<uvec2> loadedChunks;
 
 	uvec2 numBackgroundChunks;
 
 	uint32 backgroundChunkSize;
 
+	// chunks closer than this to the camera get loaded, and ones further than unloadDistance unloaded. The
+	// gap keeps chunks on the edge from going back and forth.
+	float chunkLoadDistance;
+	float chunkUnloadDistance;
+
+	// what every chunk shares
+	std::shared_ptr<TextureLibrary> backgroundImages;
+	std::shared_ptr<ModelData> chunkQuad;
+	MaterialSource* tileMapSource;
+	std::shared_ptr<const std::map<Color, uint16>> colorToTile; // read by the loader threads
+
+	std::shared_ptr<LoadedChunks> loadedChunkResults;
+
 	std::string playerControllerModuleName;
 	std::string pawnModuleName;
 
@@ -64,4 +127,6 @@ private:
 	std::string pawnClassName;
 
 	boost::signals2::signal<void(float)> tickingActors;
+
+	std::unique_ptr<WorkerPool> chunkLoaders; // last, so its threads are gone before anything else
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Engine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+
+// A DXT compressed image and all of its mip levels, as read from a .dds file. The renderer and the offline
+// tools both read these, so it doesn't know about any graphics API.
+struct DDSImage
+{
+	static const uint32 DXT1 = 0x31545844; // "DXT1" in ASCII
+	static const uint32 DXT3 = 0x33545844; // "DXT3" in ASCII
+	static const uint32 DXT5 = 0x35545844; // "DXT5" in ASCII
+
+	uint32 width;
+	uint32 height;
+	uint32 mipMapCount;
+	uint32 fourCC;			 // one of the above
+	std::vector<uint8> data; // every level, biggest first
+
+	/// <summary> How many bytes a 4x4 block takes in fourCC. </summary>
+	static uint32 getBlockSize(uint32 fourCC) { return fourCC == DXT1 ? 8 : 16; }
+
+	/// <summary> How many bytes mip level takes, for an image of width by height in fourCC. </summary>
+	inline static size_t getLevelSize(uint32 fourCC, uint32 width, uint32 height, uint32 level);
+
+	/// <summary> Reads a .dds file -- only its header if bloadData is false. </summary>
+	///
+	/// <returns> If it could be read and is in one of the formats above. </returns>
+	inline static bool load(const path_t& path, DDSImage& image, bool bloadData = true);
+};
+
+///////////////////////
+///// INLINE DEFINITIONS
+///////////////////////
+
+inline size_t DDSImage::getLevelSize(uint32 fourCC, uint32 width, uint32 height, uint32 level)
+{
+	// levels never get smaller than a pixel, even when the other side still can
+	size_t levelWidth = std::max(width >> level, 1u);
+	size_t levelHeight = std::max(height >> level, 1u);
+
+	return ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * getBlockSize(fourCC);
+}
+
+inline bool DDSImage::load(const path_t& path, DDSImage& image, bool bloadData)
+{
+	boost::filesystem::ifstream stream{path, std::ios::binary};
+	if (!stream.is_open()) return false;
+
+	char filecode[4];
+	uint8 header[124];
+	stream.read(filecode, sizeof(filecode));
+	stream.read(reinterpret_cast<char*>(header), sizeof(header));
+
+	if (!stream || std::strncmp(filecode, "DDS ", 4) != 0) return false;
+
+	auto readHeader = [&header](size_t offset)
+		{
+			uint32 value;
+			std::memcpy(&value, header + offset, sizeof(value));
+			return value;
+		};
+
+	image.height = readHeader(8);
+	image.width = readHeader(12);
+	image.mipMapCount = std::max(readHeader(24), 1u); // 0 if it doesn't have any past the first
+	image.fourCC = readHeader(80);
+
+	if (image.fourCC != DXT1 && image.fourCC != DXT3 && image.fourCC != DXT5) {
+		MFLOG(Warning) << "unrecognized compressed DDS format: " << path;
+		return false;
+	}
+
+	if (!bloadData) return true;
+
+	size_t size = 0;
+	for (uint32 level = 0; level < image.mipMapCount; ++level) {
+		size += getLevelSize(image.fourCC, image.width, image.height, level);
+	}
+
+	image.data.resize(size);
+	stream.read(reinterpret_cast<char*>(image.data.data()), size);
+
+	if (static_cast<size_t>(stream.gcount()) != size) {
+		MFLOG(Warning) << "DDS file is shorter than its header says: " << path;
+		return false;
+	}
+
+	return true;
+}
@@ -6,6 +6,7 @@
 
 // standard library includes
 #include <ios>
+#include <sstream>
 
 #include <boost/filesystem/fstream.hpp>
 
@@ -26,16 +27,11 @@ inline std::string loadFileToStr(const path_t& filename)
 		MFLOG(Warning) << "file doens't exist: " << filename;
 		return std::string();
 	}
-	// define strings for each line and the final string
-	std::string ret, build;
+	// the whole file in one read, rather than a line at a time
+	std::ostringstream ret;
+	ret << stream.rdbuf();
 
-	// while there is another line, append it to ret.
-	while (std::getline(stream, build)) {
-		ret += build;
-		ret += "\n";
-	}
-
-	return ret;
+	return ret.str();
 }
 
 // custom vector printing
@@ -2,11 +2,12 @@
 
 #include "Engine.h"
 
+#include "MaterialSource.h"
+
 #include <string>
 #include <memory>
 
 class Texture;
-class MaterialSource;
 
 class MaterialInstance
 {
@@ -21,8 +22,21 @@ public:
 	virtual MaterialSource* getSource() = 0;
 	virtual const MaterialSource* getSource() const = 0;
 
+	/// <summary> Sets a function to run every time this is drawn, before its properties are read. It runs
+	/// on the game thread, so it can set properties. </summary>
 	virtual void setUpdateCallback(std::function<void(MaterialInstance&)>) = 0;
 
+	/// <summary> Sets a property through a handle from this instance's source. Nothing is looked up and
+	/// nothing is allocated. Game thread only, like the rest of the property interface. </summary>
+	template <typename T>
+	void setProperty(MaterialProperty<T> prop, const T& value)
+	{
+		setPropertyValue(prop.ID, MaterialPropertyTypeOf<T>::value, &value);
+	}
+
+	/// <summary> What the handle version of setProperty is built on. value points to a type. </summary>
+	virtual void setPropertyValue(uint32 ID, MaterialPropertyType type, const void* value) = 0;
+
 	virtual void setProperty(const std::string& propName, int32 i) = 0;
 	virtual void setProperty(const std::string& propName, const ivec2& i) = 0;
 	virtual void setProperty(const std::string& propName, const ivec3& i) = 0;
@@ -2,6 +2,94 @@
 
 #include "Engine.h"
 
+#include <string>
+
+enum class MaterialPropertyType : uint8
+{
+	INT,
+	IVEC2,
+	IVEC3,
+	IVEC4,
+	FLOAT,
+	VEC2,
+	VEC3,
+	VEC4,
+	MAT2,
+	MAT3,
+	MAT4
+};
+
+template <typename T>
+struct MaterialPropertyTypeOf;
+
+template <>
+struct MaterialPropertyTypeOf<int32>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::INT;
+};
+template <>
+struct MaterialPropertyTypeOf<ivec2>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::IVEC2;
+};
+template <>
+struct MaterialPropertyTypeOf<ivec3>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::IVEC3;
+};
+template <>
+struct MaterialPropertyTypeOf<ivec4>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::IVEC4;
+};
+template <>
+struct MaterialPropertyTypeOf<float>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::FLOAT;
+};
+template <>
+struct MaterialPropertyTypeOf<vec2>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::VEC2;
+};
+template <>
+struct MaterialPropertyTypeOf<vec3>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::VEC3;
+};
+template <>
+struct MaterialPropertyTypeOf<vec4>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::VEC4;
+};
+template <>
+struct MaterialPropertyTypeOf<mat2>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::MAT2;
+};
+template <>
+struct MaterialPropertyTypeOf<mat3>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::MAT3;
+};
+template <>
+struct MaterialPropertyTypeOf<mat4>
+{
+	static const MaterialPropertyType value = MaterialPropertyType::MAT4;
+};
+
+const uint32 invalidMaterialPropertyID = ~uint32(0);
+
+// A material property that has already been looked up, so setting it is just a write. Only good for
+// instances of the source it came from.
+template <typename T>
+struct MaterialProperty
+{
+	uint32 ID;
+
+	bool isValid() const { return ID != invalidMaterialPropertyID; }
+};
+
 class MaterialSource
 {
 public:
@@ -10,4 +98,18 @@ public:
 	virtual void init(const path_t& name) = 0;
 
 	virtual path_t getName() const = 0;
+
+	/// <summary> Looks up a property once, so instances can set it without going by name. It has to be a T
+	/// in the shader. Asking for the same name again gives the same handle. </summary>
+	template <typename T>
+	MaterialProperty<T> getProperty(const std::string& name)
+	{
+		return MaterialProperty<T>{getPropertyID(name, MaterialPropertyTypeOf<T>::value)};
+	}
+
+	/// <summary> What getProperty is built on. </summary>
+	///
+	/// <returns> The property's ID, or invalidMaterialPropertyID if name was already asked for as another
+	/// type. </returns>
+	virtual uint32 getPropertyID(const std::string& name, MaterialPropertyType type) = 0;
 };
@@ -18,6 +18,9 @@ public:
 
 	inline virtual ~MeshComponent();
 
+	/// <summary> See Model::setStatic. </summary>
+	inline void setStatic(bool bisStatic);
+
 protected:
 	std::unique_ptr<Model, decltype(&Model::deleter)> model;
 };
@@ -35,4 +38,6 @@ inline MeshComponent::MeshComponent(Actor& owner,
 	model->init(mat, data, *this);
 }
 
-inline MeshComponent::~MeshComponent() = default;
\ No newline at end of file
+inline MeshComponent::~MeshComponent() = default;
+
+inline void MeshComponent::setStatic(bool bisStatic) { model->setStatic(bisStatic); }
\ No newline at end of file
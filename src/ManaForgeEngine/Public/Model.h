@@ -20,6 +20,10 @@ public:
 
 	virtual uint8 getRenderOrder() const = 0;
 
+	/// <summary> Promises the model won't move, so the renderer can stop checking where it is. Its transform
+	/// is read once, here -- call it again after moving it anyway. </summary>
+	virtual void setStatic(bool bisStatic) = 0;
+
 	virtual MeshComponent& getOwnerComponent() = 0;
 	virtual const MeshComponent& getOwnerComponent() const = 0;
 };
@@ -53,6 +53,11 @@ public:
 	virtual Texture* getTexture(const path_t& name) = 0;
 	virtual MaterialSource* getMaterialSource(const path_t& name) = 0;
 	virtual std::unique_ptr<TextureLibrary> newTextureLibrary() = 0;
+
+	/// <summary> Makes a texture of tile indices for a tile map shader to look images up with -- one texel
+	/// a tile, read back with texelFetch. indices is size.x * size.y, row by row from the bottom, and is
+	/// copied. </summary>
+	virtual std::unique_ptr<Texture> newTileIndexTexture(uvec2 size, const uint16* indices) = 0;
 	virtual std::unique_ptr<MaterialInstance> newMaterialInstance(MaterialSource* source) = 0;
 	virtual std::shared_ptr<ModelData> newModelData(const std::string& name) = 0;
 	virtual std::unique_ptr<ModelData> newModelData() = 0;
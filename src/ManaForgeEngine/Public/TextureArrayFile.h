@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Engine.h"
+#include "DDSImage.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+
+// What TexturePacker makes out of the images a world lists in images.txt: every image as a layer of one
+// texture array, so a texture library goes up in an upload per mip level instead of a file and an upload
+// per image.
+//
+// On disk it is the header, then each layer's name (a uint32 length, then the characters), then every mip
+// level, biggest first. A level is the blocks of each layer in turn, which is how glCompressedTexImage3D
+// takes it.
+struct TextureArrayFile
+{
+	struct Header
+	{
+		char magic[4]; // "MFTA"
+		uint32 version;
+		uint32 fourCC; // like DDSImage's
+		uint32 width;
+		uint32 height;
+		uint32 numLayers;
+		uint32 numMips;
+	};
+
+	static const uint32 currentVersion = 1;
+
+	Header header;
+	std::vector<std::string> names;			// by layer
+	std::vector<std::vector<uint8>> levels; // biggest first
+
+	/// <summary> How many bytes a layer takes in level. </summary>
+	size_t getLayerSize(uint32 level) const
+	{
+		return DDSImage::getLevelSize(header.fourCC, header.width, header.height, level);
+	}
+
+	/// <returns> If path could be read and is a texture array this version understands. </returns>
+	inline static bool load(const path_t& path, TextureArrayFile& file);
+
+	/// <returns> If it could be written. </returns>
+	inline bool save(const path_t& path) const;
+};
+
+///////////////////////
+///// INLINE DEFINITIONS
+///////////////////////
+
+inline bool TextureArrayFile::load(const path_t& path, TextureArrayFile& file)
+{
+	boost::filesystem::ifstream stream{path, std::ios::binary};
+	if (!stream.is_open()) return false;
+
+	auto&& header = file.header;
+	stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!stream || std::strncmp(header.magic, "MFTA", 4) != 0 || header.version != currentVersion) {
+		MFLOG(Warning) << "Not a texture array this version can read: " << path;
+		return false;
+	}
+
+	file.names.resize(header.numLayers);
+	for (auto&& name : file.names) {
+		uint32 length = 0;
+		stream.read(reinterpret_cast<char*>(&length), sizeof(length));
+
+		name.resize(length);
+		stream.read(&name[0], length);
+	}
+
+	file.levels.resize(header.numMips);
+	for (uint32 level = 0; level < header.numMips; ++level) {
+		auto&& data = file.levels[level];
+
+		data.resize(file.getLayerSize(level) * header.numLayers);
+		stream.read(reinterpret_cast<char*>(data.data()), data.size());
+	}
+
+	if (!stream) {
+		MFLOG(Warning) << "Texture array is shorter than its header says: " << path;
+		return false;
+	}
+
+	return true;
+}
+
+inline bool TextureArrayFile::save(const path_t& path) const
+{
+	assert(names.size() == header.numLayers && levels.size() == header.numMips);
+
+	boost::filesystem::ofstream stream{path, std::ios::binary};
+	if (!stream.is_open()) return false;
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (auto&& name : names) {
+		uint32 length = static_cast<uint32>(name.size());
+		stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		stream.write(name.data(), length);
+	}
+
+	for (auto&& data : levels) {
+		stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	return static_cast<bool>(stream);
+}
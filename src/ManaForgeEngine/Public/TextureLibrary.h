@@ -8,12 +8,26 @@
 
 #include <string>
 
+// A set of images of the same size and format that bind as one texture, like the tiles of a world.
 class TextureLibrary : public Texture
 {
 public:
+	/// <summary> Makes room for maxNumElements images of individualSize by individualSize. Images that
+	/// aren't that size can't be added. </summary>
 	virtual void init(uint16 maxNumElements, uint16 individualSize) = 0;
 
 	virtual void addImage(const std::string& name) = 0;
 
+	/// <summary> Loads a library TexturePacker made, all in one go, instead of init and addImage. The
+	/// images are named like they were in images.txt. </summary>
+	///
+	/// <returns> If the file could be read. </returns>
+	virtual bool load(const path_t& path) = 0;
+
+	/// <summary> Gets the UVs that cover the image, for use with its index. </summary>
 	virtual boost::optional<QuadUVCoords> getUVCoords(const std::string& name) = 0;
-};
\ No newline at end of file
+
+	/// <summary> Gets which image in the library this is -- its layer. This is what goes in a tile index
+	/// texture. </summary>
+	virtual boost::optional<uint16> getImageIndex(const std::string& name) = 0;
+};
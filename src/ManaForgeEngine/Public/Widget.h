@@ -5,6 +5,10 @@
 #include <vector>
 #include <limits>
 
+// The UI is retained: each widget keeps its world matrix, and the tree is only drawn again when something in
+// it changed. Changing a widget marks it and every widget above it dirty, so the root knows a pass is needed
+// and the pass knows which matrices have to be worked out again. Between passes the renderer keeps drawing
+// what the last one made.
 class Widget
 {
 public:
@@ -16,22 +20,40 @@ public:
 
 	Widget& operator=(const Widget& other) = delete;
 
+	/// <summary> Draws this widget. Only called in a pass, so whatever it makes has to last until the next
+	/// one. drawMat is the owner's world matrix. </summary>
 	inline virtual void draw(const mat3& drawMat){};
 
-	inline void drawSubObjects(const mat3& drawmat);
+	/// <summary> Draws everything under this one, working world matrices out again only for what moved.
+	/// </summary>
+	inline void drawSubObjects(const mat3& drawMat);
 
 	inline virtual void postDraw(const mat3& drawMat){};
 
+	/// <summary> If anything under this one changed since the last pass, or drawMat isn't what it was drawn
+	/// with. </summary>
+	inline bool needsDrawing(const mat3& drawMat) const;
+
 	inline const Widget* getOwner() const { return owner; }
 	inline Widget* getOwner() { return owner; }
 
-	inline void setStartRelativeLocation(const vec2& newLoc) { locationStart = newLoc; }
+	inline void setStartRelativeLocation(const vec2& newLoc);
 	inline vec2 getStartRelativeLocation() const { return locationStart; }
-	
-	inline void setEndRelativeLocation(const vec2& newLoc) { locationEnd = newLoc; }
+
+	inline void setEndRelativeLocation(const vec2& newLoc);
 	inline vec2 getEndRelativeLocation() const { return locationEnd; }
 
+	/// <summary> Where this widget's start is, as of the last pass. </summary>
+	inline const mat3& getWorldMatrix() const { return worldMat; }
+
 protected:
+	/// <summary> Asks for a pass, because what draw makes changed. </summary>
+	inline void markDirty();
+
+	/// <summary> Asks for a pass that works this widget's world matrix out again, and everything under it.
+	/// </summary>
+	inline void markLayoutDirty();
+
 	std::vector<Widget*> subWidgets;
 	std::vector<Widget*>::size_type location;
 
@@ -39,14 +61,30 @@ protected:
 	vec2 locationEnd;
 
 	Widget* const owner;
+
+private:
+	/// <summary> Draws this widget and everything under it. bownerMoved is if the owner's world matrix changed
+	/// this pass. </summary>
+	inline void drawTree(const mat3& ownerMat, bool bownerMoved);
+
+	mat3 worldMat;
+	bool bisLayoutDirty;  // worldMat is out of date
+	bool bisSubtreeDirty; // this widget or one under it changed since the last pass
 };
 
 Widget::Widget(Widget* owner)
 	: owner(owner)
+	, locationStart{}
+	, locationEnd{}
+	, worldMat{}
+	, bisLayoutDirty(true)
+	, bisSubtreeDirty(true)
 {
 	if (owner) {
 		owner->subWidgets.push_back(this);
 		location = owner->subWidgets.size() - 1;
+
+		owner->markDirty();
 	}
 }
 
@@ -60,6 +98,9 @@ Widget::Widget(Widget&& other)
 	, subWidgets(std::move(other.subWidgets))
 	, locationStart{ other.locationStart }
 	, locationEnd{ other.locationEnd }
+	, worldMat{ other.worldMat }
+	, bisLayoutDirty{ other.bisLayoutDirty }
+	, bisSubtreeDirty{ other.bisSubtreeDirty }
 {
 
 	owner->subWidgets[other.location] = this;
@@ -76,15 +117,76 @@ inline Widget::~Widget()
 		std::swap(owner->subWidgets[location], lastElem); // swap the elements
 
 		owner->subWidgets.pop_back(); // then remove the last element
+
+		// what it drew has to go
+		owner->markDirty();
 	}
 }
 
 inline void Widget::drawSubObjects(const mat3& drawMat)
 {
-	auto&& nextMat = glm::translate(drawMat, locationStart);
+	// nothing above this one keeps a matrix for it, so it checks its own
+	mat3 newWorldMat = glm::translate(drawMat, locationStart);
+	bool bmoved = bisLayoutDirty || newWorldMat != worldMat;
+
+	worldMat = newWorldMat;
+	bisLayoutDirty = false;
+
+	for (auto&& elem : subWidgets) {
+		elem->drawTree(worldMat, bmoved);
+	}
+
+	bisSubtreeDirty = false;
+}
+
+inline bool Widget::needsDrawing(const mat3& drawMat) const
+{
+	return bisSubtreeDirty || glm::translate(drawMat, locationStart) != worldMat;
+}
+
+inline void Widget::setStartRelativeLocation(const vec2& newLoc)
+{
+	if (newLoc == locationStart) return;
+
+	locationStart = newLoc;
+	markLayoutDirty();
+}
+
+inline void Widget::setEndRelativeLocation(const vec2& newLoc)
+{
+	if (newLoc == locationEnd) return;
+
+	locationEnd = newLoc;
+	markLayoutDirty();
+}
+
+inline void Widget::markDirty()
+{
+	// stop at the first one that's already marked -- everything above it is too
+	for (Widget* widget = this; widget && !widget->bisSubtreeDirty; widget = widget->owner) {
+		widget->bisSubtreeDirty = true;
+	}
+}
+
+inline void Widget::markLayoutDirty()
+{
+	bisLayoutDirty = true;
+	markDirty();
+}
+
+inline void Widget::drawTree(const mat3& ownerMat, bool bownerMoved)
+{
+	bool bmoved = bownerMoved || bisLayoutDirty;
+	if (bmoved) {
+		worldMat = glm::translate(ownerMat, locationStart);
+		bisLayoutDirty = false;
+	}
+
+	draw(ownerMat);
 	for (auto&& elem : subWidgets) {
-		elem->draw(nextMat);
-		elem->drawSubObjects(nextMat); // recursively draw subobjects
-		elem->postDraw(nextMat);
+		elem->drawTree(worldMat, bmoved);
 	}
+	postDraw(ownerMat);
+
+	bisSubtreeDirty = false;
 }
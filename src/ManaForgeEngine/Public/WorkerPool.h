@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Engine.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+// A fixed set of threads that run posted jobs, oldest first. For work like loading files that shouldn't hold
+// up the game thread -- jobs hand their results back themselves, so they shouldn't touch anything that could
+// be gone by the time they run. Destroying it drops the jobs that haven't started and waits for the rest.
+class WorkerPool : boost::noncopyable
+{
+public:
+	inline explicit WorkerPool(uint32 numThreads);
+	inline ~WorkerPool();
+
+	/// <summary> Queues job to run on one of the threads. Safe from any thread. </summary>
+	inline void post(std::function<void()> job);
+
+	/// <summary> How many jobs are still waiting for a thread. Safe from any thread. </summary>
+	inline size_t getNumQueued() const;
+
+private:
+	inline void workerLoop();
+
+	mutable std::mutex mutex;
+	std::condition_variable jobPosted;
+	std::deque<std::function<void()>> jobs;
+	bool bisStopping;
+
+	std::vector<std::thread> threads; // last, so everything they use is there before they start
+};
+
+///////////////////////
+///// INLINE DEFINITIONS
+///////////////////////
+
+inline WorkerPool::WorkerPool(uint32 numThreads)
+	: bisStopping(false)
+{
+	assert(numThreads > 0);
+
+	threads.reserve(numThreads);
+	for (uint32 i = 0; i < numThreads; ++i) {
+		threads.emplace_back([this]
+			{
+				workerLoop();
+			});
+	}
+}
+
+inline WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		bisStopping = true;
+		jobs.clear();
+	}
+	jobPosted.notify_all();
+
+	for (auto&& thread : threads) {
+		thread.join();
+	}
+}
+
+inline void WorkerPool::post(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		jobs.push_back(std::move(job));
+	}
+	jobPosted.notify_one();
+}
+
+inline size_t WorkerPool::getNumQueued() const
+{
+	std::lock_guard<std::mutex> lock{mutex};
+	return jobs.size();
+}
+
+inline void WorkerPool::workerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock{mutex};
+			jobPosted.wait(lock, [this]
+				{
+					return bisStopping || !jobs.empty();
+				});
+
+			if (bisStopping) return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		// an Error log throws, and one job failing shouldn't take the process with it
+		try
+		{
+			job();
+		}
+		catch (ENGException& e)
+		{
+			MFLOG(Warning) << "A worker job failed: " << e.what();
+		}
+		catch (std::exception& e)
+		{
+			MFLOG(Warning) << "A worker job threw: " << e.what();
+		}
+	}
+}
@@ -0,0 +1,288 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLBatcher.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLMaterialInstance.h"
+#include "OpenGLModel.h"
+#include "OpenGLModelData.h"
+#include "OpenGLStateCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+OpenGLBatcher::OpenGLBatcher(OpenGLStateCache& stateCache)
+	: stateCache(stateCache)
+	, instanceBuffer(0)
+	, instanceBufferCapacity(0)
+	, lastStats{}
+{
+}
+
+void OpenGLBatcher::draw(const OpenGLDrawPacket* packets, size_t numPackets)
+{
+	items.clear();
+	programIDs.clear();
+	materialIDs.clear();
+	meshIDs.clear();
+
+	for (uint32 i = 0; i < numPackets; ++i) {
+		auto&& packet = packets[i];
+		auto&& source = static_cast<OpenGLMaterialSource*>(packet.material->getSource());
+
+		// these have to get there even if it isn't drawn this time
+		packet.material->applyPropertyUpdates(packet.propertyUpdates, packet.numPropertyUpdates);
+		if (packet.textureBindings) packet.material->applyTextureBindings(*packet.textureBindings);
+
+		// skip anything that hasn't finished uploading yet. Textures that haven't just bind nothing.
+		if (!packet.modelData->isResident() || !source->isResident()) continue;
+
+		// this lays out the instance properties and the signature, so it has to happen before they are read
+		packet.material->update();
+
+		uint64 program = getFrameID<const OpenGLMaterialSource*>(programIDs, source, programMask);
+		uint64 material = getFrameID<const OpenGLMaterialInstance*>(materialIDs, packet.material, materialMask);
+		uint64 mesh = getFrameID<const OpenGLModelData*>(meshIDs, packet.modelData, meshMask);
+
+		// opaque ones go front to back, so the order is flipped for them
+		bool btranslucent = !source->isOpaque();
+		uint64 order = btranslucent ? packet.renderOrder : 255 - packet.renderOrder;
+
+		SortItem item;
+		item.key = (uint64(btranslucent) << translucentShift) | (order << renderOrderShift)
+			| (program << programShift) | (material << materialShift) | mesh;
+		item.packetIndex = i;
+
+		items.push_back(item);
+	}
+
+	auto unsortedChanges = countStateChanges(items);
+
+	sortItems();
+
+	// in the order they will be drawn, so every batch is one contiguous range
+	instances.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i) {
+		auto&& packet = packets[items[i].packetIndex];
+
+		instances[i].modelMat = packet.modelMat;
+
+		auto&& properties = packet.material->getInstanceProperties();
+		std::copy(properties.begin(), properties.end(), instances[i].properties);
+	}
+
+	uploadInstances();
+
+	uint64 numDrawCalls = 0;
+	uint64 numOpaqueModels = 0;
+
+	beginPass(false);
+	bool binTranslucentPass = false;
+
+	for (size_t begin = 0; begin < items.size();) {
+		size_t end = begin + 1;
+		while (end < items.size() && items[end].key == items[begin].key) {
+			++end;
+		}
+
+		// everything in the batch looks the same, so the first one's material stands in for all of them
+		auto&& first = packets[items[begin].packetIndex];
+		auto&& source = *static_cast<OpenGLMaterialSource*>(first.material->getSource());
+
+		bool btranslucent = (items[begin].key >> translucentShift) != 0;
+		if (btranslucent && !binTranslucentPass) {
+			beginPass(true);
+			binTranslucentPass = true;
+		}
+		if (!btranslucent) numOpaqueModels += end - begin;
+
+		first.material->use();
+
+		// the shaders turn it into depth
+		GLint location = source.renderOrderUniformLocation;
+		float renderOrder = first.renderOrder;
+		if (location != -1 && stateCache.shouldSetUniform(location, &renderOrder, sizeof(renderOrder))) {
+			glUniform1f(location, renderOrder);
+		}
+
+		first.modelData->bind();
+		bindInstanceAttributes(source, begin);
+		first.modelData->drawInstances(static_cast<GLsizei>(end - begin));
+
+		++numDrawCalls;
+		begin = end;
+	}
+
+	endPasses();
+
+	std::lock_guard<std::mutex> lock{statsMutex};
+
+	lastStats.numModels = items.size();
+	lastStats.numOpaqueModels = numOpaqueModels;
+	lastStats.numDrawCalls = numDrawCalls;
+	lastStats.unsortedChanges = unsortedChanges;
+	lastStats.sortedChanges = countStateChanges(items);
+}
+
+size_t OpenGLBatcher::MaterialBatchHash::operator()(const OpenGLMaterialInstance* material) const
+{
+	return material->getBatchSignature();
+}
+
+bool OpenGLBatcher::MaterialBatchEqual::operator()(
+	const OpenGLMaterialInstance* a, const OpenGLMaterialInstance* b) const
+{
+	return a == b || a->drawsSameAs(*b);
+}
+
+void OpenGLBatcher::releaseBuffers(OpenGLDeletionQueue& deletionQueue)
+{
+	deletionQueue.retire(OpenGLObjectType::BUFFER, instanceBuffer);
+
+	instanceBuffer = 0;
+	instanceBufferCapacity = 0;
+}
+
+RenderBatchStats OpenGLBatcher::getStats() const
+{
+	std::lock_guard<std::mutex> lock{statsMutex};
+	return lastStats;
+}
+
+void OpenGLBatcher::sortItems()
+{
+	if (items.empty()) return;
+
+	sortScratch.resize(items.size());
+
+	// count every byte in one go
+	std::array<std::array<size_t, 256>, 8> counts{};
+	for (auto&& item : items) {
+		for (uint32 byte = 0; byte < 8; ++byte) {
+			++counts[byte][(item.key >> (byte * 8)) & 0xFF];
+		}
+	}
+
+	for (uint32 byte = 0; byte < 8; ++byte) {
+		auto&& count = counts[byte];
+
+		// every key has the same value here, so this pass wouldn't move anything
+		if (count[(items[0].key >> (byte * 8)) & 0xFF] == items.size()) continue;
+
+		std::array<size_t, 256> offsets;
+		size_t total = 0;
+		for (uint32 i = 0; i < 256; ++i) {
+			offsets[i] = total;
+			total += count[i];
+		}
+
+		for (auto&& item : items) {
+			sortScratch[offsets[(item.key >> (byte * 8)) & 0xFF]++] = item;
+		}
+
+		items.swap(sortScratch);
+	}
+}
+
+RenderStateChangeStats OpenGLBatcher::countStateChanges(const std::vector<SortItem>& sequence)
+{
+	RenderStateChangeStats ret{};
+
+	for (size_t i = 1; i < sequence.size(); ++i) {
+		uint64 previous = sequence[i - 1].key;
+		uint64 current = sequence[i].key;
+
+		if (((previous >> programShift) & programMask) != ((current >> programShift) & programMask)) {
+			++ret.programChanges;
+		}
+		else if (((previous >> materialShift) & materialMask) != ((current >> materialShift) & materialMask))
+		{
+			++ret.materialChanges;
+		}
+
+		if ((previous & meshMask) != (current & meshMask)) ++ret.meshChanges;
+	}
+
+	return ret;
+}
+
+void OpenGLBatcher::beginPass(bool btranslucent)
+{
+	if (btranslucent) {
+		glDepthMask(GL_FALSE);
+		glEnable(GL_BLEND);
+	}
+	else
+	{
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+}
+
+void OpenGLBatcher::endPasses()
+{
+	// text and debug shapes are drawn in order, on top, and the depth buffer can only be cleared while it
+	// can be written
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_BLEND);
+}
+
+void OpenGLBatcher::uploadInstances()
+{
+	if (instances.empty()) return;
+
+	if (instanceBuffer == 0) glGenBuffers(1, &instanceBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	if (instances.size() > instanceBufferCapacity) {
+		instanceBufferCapacity = std::max(instances.size(), instanceBufferCapacity * 2);
+	}
+
+	// orphan last frame's storage so this doesn't wait for the draws still reading it
+	glBufferData(
+		GL_ARRAY_BUFFER, sizeof(OpenGLInstanceData) * instanceBufferCapacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(OpenGLInstanceData) * instances.size(), instances.data());
+}
+
+void OpenGLBatcher::bindInstanceAttributes(const OpenGLMaterialSource& source, size_t firstInstance)
+{
+	const GLsizei stride = sizeof(OpenGLInstanceData);
+	size_t base = sizeof(OpenGLInstanceData) * firstInstance;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	// a mat3 attribute is three vec3 columns
+	for (GLuint column = 0; column < 3; ++column) {
+		GLuint location = OpenGLMaterialSource::instanceModelMatLocation + column;
+		size_t offset = base + offsetof(OpenGLInstanceData, modelMat) + sizeof(vec3) * column;
+
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+		glVertexAttribDivisor(location, 1);
+	}
+
+	for (uint32 slot = 0; slot < OpenGLMaterialSource::maxInstanceProperties; ++slot) {
+		GLuint location = OpenGLMaterialSource::firstInstancePropertyLocation + slot;
+
+		if (!source.hasInstanceProperty(slot)) {
+			glDisableVertexAttribArray(location);
+			continue;
+		}
+
+		size_t offset = base + offsetof(OpenGLInstanceData, properties) + sizeof(uint32) * slot;
+
+		glEnableVertexAttribArray(location);
+		if (source.isInstancePropertyInteger(slot)) {
+			glVertexAttribIPointer(location, 1, GL_INT, stride, reinterpret_cast<void*>(offset));
+		}
+		else
+		{
+			glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+		}
+		glVertexAttribDivisor(location, 1);
+	}
+}
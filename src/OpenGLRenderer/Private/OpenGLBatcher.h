@@ -0,0 +1,145 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLMaterialSource.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct OpenGLDrawPacket;
+class OpenGLDeletionQueue;
+class OpenGLMaterialInstance;
+class OpenGLModelData;
+class OpenGLStateCache;
+
+// What the model shaders read per instance. See OpenGLMaterialSource for the attribute locations.
+struct OpenGLInstanceData
+{
+	mat3 modelMat;
+
+	// int or float bits, whichever the shader takes
+	uint32 properties[OpenGLMaterialSource::maxInstanceProperties];
+};
+
+// How often consecutive draws switched something -- what the GL would have to rebind.
+struct RenderStateChangeStats
+{
+	uint64 programChanges;
+	uint64 materialChanges; // textures or uniforms, with the program staying the same
+	uint64 meshChanges;
+};
+
+struct RenderBatchStats
+{
+	uint64 numModels;		// models drawn
+	uint64 numOpaqueModels; // of those, drawn front to back in the opaque pass
+	uint64 numDrawCalls;	// instanced draws they went out in
+
+	RenderStateChangeStats unsortedChanges; // in the order the models were submitted
+	RenderStateChangeStats sortedChanges;	// in the order they were drawn
+};
+
+// Turns a frame's draw packets into as few draw calls as it can. Every packet gets a 64 bit sort key
+//
+//   | translucent : 1 | render order : 8 | program : 12 | material state : 20 | mesh : 23 |
+//
+// and they are radix sorted by it, so render order is kept and state changes are as rare as possible. Runs of
+// equal keys are the same in every way that matters and go out as one glDrawElementsInstanced, with their
+// transforms and instance properties in a buffer that is uploaded once per frame. Render thread only, unless
+// noted.
+//
+// Models with opaque materials go first, front to back -- their render order is flipped in the key -- with
+// depth writes on and blending off, so everything behind them fails the depth test instead of being shaded
+// and blended over. Translucent ones go after, back to front, blended and depth tested but not writing it.
+// Render order is the depth, so higher render orders are in front.
+class OpenGLBatcher
+{
+public:
+	explicit OpenGLBatcher(OpenGLStateCache& stateCache);
+
+	OpenGLBatcher(const OpenGLBatcher& other) = delete;
+	OpenGLBatcher& operator=(const OpenGLBatcher& other) = delete;
+
+	/// <summary> Draws every packet that is ready, in any order they come in. </summary>
+	void draw(const OpenGLDrawPacket* packets, size_t numPackets);
+
+	/// <summary> Hands the instance buffer to the deletion queue. </summary>
+	void releaseBuffers(OpenGLDeletionQueue& deletionQueue);
+
+	/// <summary> Gets what the last frame came to. Safe from any thread. </summary>
+	RenderBatchStats getStats() const;
+
+private:
+	struct SortItem
+	{
+		uint64 key;
+		uint32 packetIndex;
+	};
+
+	static const uint32 translucentShift = 63;
+	static const uint32 renderOrderShift = 55;
+	static const uint32 programShift = 43;
+	static const uint32 materialShift = 23;
+	static const uint64 programMask = (1ull << 12) - 1;
+	static const uint64 materialMask = (1ull << 20) - 1;
+	static const uint64 meshMask = (1ull << 23) - 1;
+
+	// materials that would draw the same share an ID. The signature only finds the candidates quickly --
+	// two that hash the same are compared in full, so they can't be merged by a collision.
+	struct MaterialBatchHash
+	{
+		size_t operator()(const OpenGLMaterialInstance* material) const;
+	};
+	struct MaterialBatchEqual
+	{
+		bool operator()(const OpenGLMaterialInstance* a, const OpenGLMaterialInstance* b) const;
+	};
+
+	/// <summary> Gets a small ID for key that is the same for the rest of the frame. </summary>
+	template <typename Key, typename Map>
+	static uint64 getFrameID(Map& ids, const Key& key, uint64 mask);
+
+	/// <summary> Stable LSD radix sort of items by key, a byte at a time. Skips bytes that are the same in
+	/// every key. </summary>
+	void sortItems();
+
+	static RenderStateChangeStats countStateChanges(const std::vector<SortItem>& sequence);
+
+	/// <summary> Sets depth and blending up for the opaque pass, or the translucent one. </summary>
+	static void beginPass(bool btranslucent);
+
+	/// <summary> Puts depth and blending back how everything drawn after the models expects them. </summary>
+	static void endPasses();
+
+	void uploadInstances();
+	void bindInstanceAttributes(const OpenGLMaterialSource& source, size_t firstInstance);
+
+	OpenGLStateCache& stateCache;
+
+	GLuint instanceBuffer;
+	size_t instanceBufferCapacity; // in instances
+
+	// kept between frames so they stop allocating
+	std::vector<SortItem> items;
+	std::vector<SortItem> sortScratch;
+	std::vector<OpenGLInstanceData> instances;
+
+	// this frame's IDs for the sort keys
+	std::unordered_map<const OpenGLMaterialSource*, uint32> programIDs;
+	std::unordered_map<const OpenGLMaterialInstance*, uint32, MaterialBatchHash, MaterialBatchEqual> materialIDs;
+	std::unordered_map<const OpenGLModelData*, uint32> meshIDs;
+
+	mutable std::mutex statsMutex;
+	RenderBatchStats lastStats;
+};
+
+template <typename Key, typename Map>
+uint64 OpenGLBatcher::getFrameID(Map& ids, const Key& key, uint64 mask)
+{
+	auto ret = ids.emplace(key, static_cast<uint32>(ids.size())).first->second;
+
+	// a frame would need millions of distinct meshes to run out
+	assert(ret <= mask);
+	return ret & mask;
+}
@@ -0,0 +1,84 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLCommandBuffer.h"
+
+#include <algorithm>
+
+OpenGLCommandBuffer::OpenGLCommandBuffer(size_t blockSize)
+	: currentBlock(0)
+	, blockSize(blockSize)
+	, firstCommand(nullptr)
+	, lastCommand(nullptr)
+	, numCommands(0)
+{
+}
+
+OpenGLCommandBuffer::~OpenGLCommandBuffer() { reset(); }
+
+void OpenGLCommandBuffer::execute()
+{
+	for (auto command = firstCommand; command; command = command->next) {
+		command->invoke(command->storage);
+	}
+}
+
+void OpenGLCommandBuffer::reset()
+{
+	for (auto command = firstCommand; command; command = command->next) {
+		if (command->destroy) command->destroy(command->storage);
+	}
+
+	for (auto&& block : blocks) {
+		block.used = 0;
+	}
+
+	currentBlock = 0;
+	firstCommand = nullptr;
+	lastCommand = nullptr;
+	numCommands = 0;
+}
+
+size_t OpenGLCommandBuffer::getUsedBytes() const
+{
+	size_t ret = 0;
+	for (auto&& block : blocks) {
+		ret += block.used;
+	}
+
+	return ret;
+}
+
+size_t OpenGLCommandBuffer::getCapacity() const
+{
+	size_t ret = 0;
+	for (auto&& block : blocks) {
+		ret += block.size;
+	}
+
+	return ret;
+}
+
+void* OpenGLCommandBuffer::allocateRaw(size_t size, size_t alignment)
+{
+	// find the first block from the current one that can hold it
+	for (; currentBlock < blocks.size(); ++currentBlock) {
+		auto&& block = blocks[currentBlock];
+
+		size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+		if (start + size <= block.size) {
+			block.used = start + size;
+			return block.memory.get() + start;
+		}
+	}
+
+	// none of them fit -- grow. This only happens until the buffer has seen its biggest frame.
+	Block newBlock;
+	newBlock.size = std::max(blockSize, size + alignment);
+	newBlock.memory = std::make_unique<uint8[]>(newBlock.size);
+	newBlock.used = 0;
+
+	blocks.push_back(std::move(newBlock));
+	currentBlock = blocks.size() - 1;
+
+	return allocateRaw(size, alignment);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A linear arena of render commands. Commands are stored inline (no std::function, no shared state) and
+// run in the order they were recorded. reset() rewinds the arena but keeps its memory, so once a buffer has
+// grown to the size of a typical frame, recording into it does not touch the heap.
+class OpenGLCommandBuffer
+{
+public:
+	explicit OpenGLCommandBuffer(size_t blockSize = 64 * 1024);
+
+	~OpenGLCommandBuffer();
+
+	OpenGLCommandBuffer(const OpenGLCommandBuffer& other) = delete;
+	OpenGLCommandBuffer(OpenGLCommandBuffer&& other) = delete;
+
+	OpenGLCommandBuffer& operator=(const OpenGLCommandBuffer& other) = delete;
+	OpenGLCommandBuffer& operator=(OpenGLCommandBuffer&& other) = delete;
+
+	/// <summary> Records a command. The callable is moved into the buffer and destroyed on reset. Capture
+	/// by value, and copy any arrays with allocate first -- capturing containers would allocate again.
+	/// </summary>
+	template <typename Function>
+	inline void record(Function&& func);
+
+	/// <summary> Gets storage for count elements that stays valid until the next reset. </summary>
+	template <typename T>
+	inline T* allocate(size_t count);
+
+	/// <summary> Runs every recorded command in order. </summary>
+	void execute();
+
+	/// <summary> Destroys every recorded command and forgets every allocation, but keeps the memory.
+	/// </summary>
+	void reset();
+
+	size_t getNumCommands() const { return numCommands; }
+	size_t getUsedBytes() const;
+	size_t getCapacity() const;
+
+private:
+	struct CommandHeader
+	{
+		void (*invoke)(void* storage);
+		void (*destroy)(void* storage); // nullptr if there is nothing to destroy
+		void* storage;
+		CommandHeader* next;
+	};
+
+	template <typename Function>
+	static void invokeCommand(void* storage)
+	{
+		(*static_cast<Function*>(storage))();
+	}
+
+	template <typename Function>
+	static void destroyCommand(void* storage)
+	{
+		static_cast<Function*>(storage)->~Function();
+	}
+
+	void* allocateRaw(size_t size, size_t alignment);
+
+	struct Block
+	{
+		std::unique_ptr<uint8[]> memory;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Block> blocks;
+	size_t currentBlock;
+	size_t blockSize;
+
+	CommandHeader* firstCommand;
+	CommandHeader* lastCommand;
+	size_t numCommands;
+};
+
+template <typename Function>
+inline void OpenGLCommandBuffer::record(Function&& func)
+{
+	using func_t = std::decay_t<Function>;
+
+	auto header = static_cast<CommandHeader*>(allocateRaw(sizeof(CommandHeader), alignof(CommandHeader)));
+	void* storage = allocateRaw(sizeof(func_t), alignof(func_t));
+
+	new (storage) func_t(std::forward<Function>(func));
+
+	header->invoke = &invokeCommand<func_t>;
+	header->destroy = std::is_trivially_destructible<func_t>::value ? nullptr : &destroyCommand<func_t>;
+	header->storage = storage;
+	header->next = nullptr;
+
+	if (lastCommand) {
+		lastCommand->next = header;
+	}
+	else
+	{
+		firstCommand = header;
+	}
+	lastCommand = header;
+
+	++numCommands;
+}
+
+template <typename T>
+inline T* OpenGLCommandBuffer::allocate(size_t count)
+{
+	static_assert(std::is_trivially_destructible<T>::value, "Render data must be trivially destructible.");
+
+	if (count == 0) return nullptr;
+
+	return static_cast<T*>(allocateRaw(sizeof(T) * count, alignof(T)));
+}
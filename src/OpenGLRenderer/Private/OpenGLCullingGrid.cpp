@@ -0,0 +1,103 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLCullingGrid.h"
+
+OpenGLBounds OpenGLBounds::transformed(const mat3& transform, vec2 min, vec2 max)
+{
+	const vec2 corners[] = {min, vec2(max.x, min.y), vec2(min.x, max.y), max};
+
+	vec2 first = vec2(transform * vec3(corners[0], 1.f));
+	OpenGLBounds ret{first, first};
+
+	for (uint32 i = 1; i < 4; ++i) {
+		vec2 corner = vec2(transform * vec3(corners[i], 1.f));
+
+		ret.min = glm::min(ret.min, corner);
+		ret.max = glm::max(ret.max, corner);
+	}
+
+	return ret;
+}
+
+OpenGLCullingGrid::OpenGLCullingGrid(float cellSize)
+	: cellSize(cellSize)
+	, numQueries(0)
+{
+}
+
+void OpenGLCullingGrid::setCellSize(float newCellSize)
+{
+	assert(items.empty());
+	assert(newCellSize > 0.f);
+
+	cellSize = newCellSize;
+}
+
+void OpenGLCullingGrid::insert(OpenGLModel& model, const OpenGLBounds& bounds)
+{
+	assert(items.find(&model) == items.end());
+
+	auto&& item = items[&model];
+	item.model = &model;
+	item.bounds = bounds;
+	item.minCell = getCell(bounds.min);
+	item.maxCell = getCell(bounds.max);
+	item.lastQuery = numQueries;
+
+	int64 numCells =
+		int64(item.maxCell.x - item.minCell.x + 1) * int64(item.maxCell.y - item.minCell.y + 1);
+	item.bisOversized = numCells > maxCellsPerItem;
+
+	if (item.bisOversized) {
+		oversized.push_back(&item);
+		return;
+	}
+
+	for (int32 y = item.minCell.y; y <= item.maxCell.y; ++y) {
+		for (int32 x = item.minCell.x; x <= item.maxCell.x; ++x) {
+			cells[getCellKey(ivec2(x, y))].push_back(&item);
+		}
+	}
+}
+
+void OpenGLCullingGrid::remove(OpenGLModel& model)
+{
+	auto iter = items.find(&model);
+	if (iter == items.end()) return;
+
+	auto&& item = iter->second;
+
+	// order in a cell doesn't matter, so swap it with the last one
+	auto eraseFrom = [&item](std::vector<Item*>& list)
+		{
+			auto found = std::find(list.begin(), list.end(), &item);
+			assert(found != list.end());
+
+			*found = list.back();
+			list.pop_back();
+		};
+
+	if (item.bisOversized) {
+		eraseFrom(oversized);
+	}
+	else
+	{
+		for (int32 y = item.minCell.y; y <= item.maxCell.y; ++y) {
+			for (int32 x = item.minCell.x; x <= item.maxCell.x; ++x) {
+				auto cell = cells.find(getCellKey(ivec2(x, y)));
+				assert(cell != cells.end());
+
+				eraseFrom(cell->second);
+				if (cell->second.empty()) cells.erase(cell);
+			}
+		}
+	}
+
+	items.erase(iter);
+}
+
+ivec2 OpenGLCullingGrid::getCell(vec2 location) const
+{
+	vec2 cell = glm::floor(location / cellSize);
+	return ivec2(static_cast<int32>(cell.x), static_cast<int32>(cell.y));
+}
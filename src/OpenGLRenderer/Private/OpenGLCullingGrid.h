@@ -0,0 +1,144 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+class OpenGLModel;
+
+// An axis aligned box in world space.
+struct OpenGLBounds
+{
+	vec2 min;
+	vec2 max;
+
+	/// <summary> Gets the box around the rectangle from min to max once it has gone through transform.
+	/// </summary>
+	static OpenGLBounds transformed(const mat3& transform, vec2 min, vec2 max);
+
+	bool intersects(const OpenGLBounds& other) const
+	{
+		return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+	}
+};
+
+struct RenderCullStats
+{
+	uint64 numModels;  // everything that could have been drawn
+	uint64 numTested;  // had their bounds checked against the view -- the grid skips the rest
+	uint64 numVisible; // what was left to draw
+	uint64 numCulled;
+};
+
+// Buckets static models by the cells of a uniform grid their bounds overlap, so a query only has to look at
+// the models near what it asks for. Cells are only made once something is in them, so the world can be any
+// size. Models that move aren't kept in here -- their bounds would have to be worked out every frame anyway.
+// Game thread only.
+class OpenGLCullingGrid
+{
+public:
+	explicit OpenGLCullingGrid(float cellSize = 32.f);
+
+	OpenGLCullingGrid(const OpenGLCullingGrid& other) = delete;
+	OpenGLCullingGrid& operator=(const OpenGLCullingGrid& other) = delete;
+
+	/// <summary> Sets how big a side of a cell is, in world units. Only while it is empty. </summary>
+	void setCellSize(float newCellSize);
+
+	void insert(OpenGLModel& model, const OpenGLBounds& bounds);
+	void remove(OpenGLModel& model);
+
+	/// <summary> How many models are in it. </summary>
+	size_t size() const { return items.size(); }
+
+	/// <summary> Calls func with each model whose bounds intersect bounds, once each. </summary>
+	///
+	/// <returns> How many models had their bounds checked. </returns>
+	template <typename Function>
+	uint64 query(const OpenGLBounds& bounds, Function&& func);
+
+private:
+	struct Item
+	{
+		OpenGLModel* model;
+		OpenGLBounds bounds;
+
+		ivec2 minCell;
+		ivec2 maxCell;
+		bool bisOversized;
+
+		uint64 lastQuery; // so models in more than one cell are only checked once a query
+	};
+
+	// anything that would be in more cells than this goes in oversized instead, so it is checked every query
+	static const int32 maxCellsPerItem = 64;
+
+	ivec2 getCell(vec2 location) const;
+
+	static uint64 getCellKey(ivec2 cell)
+	{
+		return (uint64(uint32(cell.x)) << 32) | uint32(cell.y);
+	}
+
+	/// <summary> Checks item against bounds, if this query hasn't yet. </summary>
+	template <typename Function>
+	void visit(Item& item, const OpenGLBounds& bounds, uint64& numTested, Function&& func);
+
+	float cellSize;
+
+	std::unordered_map<OpenGLModel*, Item> items; // nodes don't move, so the cells can point into it
+	std::unordered_map<uint64, std::vector<Item*>> cells;
+	std::vector<Item*> oversized;
+
+	uint64 numQueries;
+};
+
+template <typename Function>
+uint64 OpenGLCullingGrid::query(const OpenGLBounds& bounds, Function&& func)
+{
+	++numQueries;
+	uint64 numTested = 0;
+
+	for (auto&& item : oversized) {
+		visit(*item, bounds, numTested, func);
+	}
+
+	ivec2 minCell = getCell(bounds.min);
+	ivec2 maxCell = getCell(bounds.max);
+	uint64 numCellsInBounds = uint64(maxCell.x - minCell.x + 1) * uint64(maxCell.y - minCell.y + 1);
+
+	// zoomed far enough out, it's quicker to go through the cells that exist than every one in view
+	if (numCellsInBounds > cells.size()) {
+		for (auto&& cell : cells) {
+			for (auto&& item : cell.second) {
+				visit(*item, bounds, numTested, func);
+			}
+		}
+
+		return numTested;
+	}
+
+	for (int32 y = minCell.y; y <= maxCell.y; ++y) {
+		for (int32 x = minCell.x; x <= maxCell.x; ++x) {
+			auto cell = cells.find(getCellKey(ivec2(x, y)));
+			if (cell == cells.end()) continue;
+
+			for (auto&& item : cell->second) {
+				visit(*item, bounds, numTested, func);
+			}
+		}
+	}
+
+	return numTested;
+}
+
+template <typename Function>
+void OpenGLCullingGrid::visit(Item& item, const OpenGLBounds& bounds, uint64& numTested, Function&& func)
+{
+	if (item.lastQuery == numQueries) return;
+	item.lastQuery = numQueries;
+
+	++numTested;
+	if (item.bounds.intersects(bounds)) func(*item.model);
+}
@@ -0,0 +1,151 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLDebugDraw.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLStateCache.h"
+
+OpenGLDebugDraw::OpenGLDebugDraw(OpenGLStateCache& stateCache)
+	: stateCache(stateCache)
+	, viewBounds{vec2(0.f), vec2(0.f)}
+	, stats{}
+	, lastStats{}
+	, vertexArray(0)
+{
+}
+
+void OpenGLDebugDraw::beginFrame(const OpenGLBounds& newViewBounds)
+{
+	lastStats = stats;
+	lastStats.numLineVertices = lines.size();
+	lastStats.numTriangleVertices = triangles.size();
+
+	viewBounds = newViewBounds;
+	lines.clear();
+	triangles.clear();
+	stats = RenderDebugDrawStats{};
+}
+
+void OpenGLDebugDraw::addSegment(vec2 p1, vec2 p2, Color color)
+{
+	vec2 verts[] = {p1, p2};
+	if (!isVisible(verts, 2)) return;
+
+	uint32 packed = packColor(color);
+	lines.push_back(OpenGLDebugVertex{p1, packed});
+	lines.push_back(OpenGLDebugVertex{p2, packed});
+}
+
+void OpenGLDebugDraw::addLineStrip(const vec2* verts, uint32 numVerts, Color color)
+{
+	if (numVerts < 2 || !isVisible(verts, numVerts)) return;
+
+	uint32 packed = packColor(color);
+	for (uint32 i = 0; i + 1 < numVerts; ++i) {
+		lines.push_back(OpenGLDebugVertex{verts[i], packed});
+		lines.push_back(OpenGLDebugVertex{verts[i + 1], packed});
+	}
+}
+
+void OpenGLDebugDraw::addLineLoop(const vec2* verts, uint32 numVerts, Color color)
+{
+	if (numVerts < 2 || !isVisible(verts, numVerts)) return;
+
+	appendLoop(verts, numVerts, packColor(color));
+}
+
+void OpenGLDebugDraw::addSolidPolygon(const vec2* verts, uint32 numVerts, Color color)
+{
+	if (numVerts < 3 || !isVisible(verts, numVerts)) return;
+
+	// the fill is the outline color at half strength, alpha and all, as it has always been
+	uint32 fill = packColor(Color(color.red / 2, color.green / 2, color.blue / 2, color.alpha / 2));
+	for (uint32 i = 1; i + 1 < numVerts; ++i) {
+		triangles.push_back(OpenGLDebugVertex{verts[0], fill});
+		triangles.push_back(OpenGLDebugVertex{verts[i], fill});
+		triangles.push_back(OpenGLDebugVertex{verts[i + 1], fill});
+	}
+
+	appendLoop(verts, numVerts, packColor(color));
+}
+
+void OpenGLDebugDraw::appendLoop(const vec2* verts, uint32 numVerts, uint32 packedColor)
+{
+	for (uint32 i = 0; i < numVerts; ++i) {
+		lines.push_back(OpenGLDebugVertex{verts[i], packedColor});
+		lines.push_back(OpenGLDebugVertex{verts[(i + 1) % numVerts], packedColor});
+	}
+}
+
+uint32 OpenGLDebugDraw::packColor(Color color)
+{
+	// the bytes end up in memory as red, green, blue, alpha
+	return uint32(color.red) | uint32(color.green) << 8 | uint32(color.blue) << 16
+		| uint32(color.alpha) << 24;
+}
+
+bool OpenGLDebugDraw::isVisible(const vec2* verts, uint32 numVerts)
+{
+	++stats.numShapes;
+
+	OpenGLBounds bounds{verts[0], verts[0]};
+	for (uint32 i = 1; i < numVerts; ++i) {
+		bounds.min = glm::min(bounds.min, verts[i]);
+		bounds.max = glm::max(bounds.max, verts[i]);
+	}
+
+	if (bounds.intersects(viewBounds)) return true;
+
+	++stats.numCulled;
+	return false;
+}
+
+void OpenGLDebugDraw::draw(const OpenGLDebugVertex* lineVerts,
+	size_t numLineVerts,
+	const OpenGLDebugVertex* triangleVerts,
+	size_t numTriangleVerts)
+{
+	if (numLineVerts + numTriangleVerts == 0) return;
+
+	if (vertexArray == 0) {
+		glGenVertexArrays(1, &vertexArray);
+		stateCache.bindVertexArray(vertexArray);
+
+		vertices.bind();
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0,
+			2,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(OpenGLDebugVertex),
+			reinterpret_cast<void*>(offsetof(OpenGLDebugVertex, position)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1,
+			4,
+			GL_UNSIGNED_BYTE,
+			GL_TRUE,
+			sizeof(OpenGLDebugVertex),
+			reinterpret_cast<void*>(offsetof(OpenGLDebugVertex, color)));
+	}
+
+	stateCache.bindVertexArray(vertexArray);
+
+	// each goes out before the other is written, since writing can orphan what came before
+	if (numTriangleVerts != 0) {
+		GLint first = vertices.write(triangleVerts, numTriangleVerts, sizeof(OpenGLDebugVertex));
+		glDrawArrays(GL_TRIANGLES, first, static_cast<GLsizei>(numTriangleVerts));
+	}
+
+	if (numLineVerts != 0) {
+		GLint first = vertices.write(lineVerts, numLineVerts, sizeof(OpenGLDebugVertex));
+		glDrawArrays(GL_LINES, first, static_cast<GLsizei>(numLineVerts));
+	}
+}
+
+void OpenGLDebugDraw::releaseBuffers(OpenGLDeletionQueue& deletionQueue)
+{
+	deletionQueue.retire(OpenGLObjectType::VERTEX_ARRAY, vertexArray);
+	vertices.release(deletionQueue);
+
+	vertexArray = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLCullingGrid.h"
+#include "OpenGLStreamBuffer.h"
+
+#include <Color.h>
+
+#include <vector>
+
+class OpenGLDeletionQueue;
+class OpenGLStateCache;
+
+// What debugdrawvert.glsl reads. The color is RGBA8, normalized on the way in.
+struct OpenGLDebugVertex
+{
+	vec2 position;
+	uint32 color;
+};
+
+struct RenderDebugDrawStats
+{
+	uint64 numShapes;			// drawDebug* calls
+	uint64 numCulled;			// shapes left out because they were off screen
+	uint64 numLineVertices;		// two a segment
+	uint64 numTriangleVertices; // three a triangle
+};
+
+// Collects a frame's debug shapes into one stream of lines and one of triangles, so they go out in two draw
+// calls however many shapes there are. Shapes are added on the game thread, and anything off screen is
+// dropped right there. The streams are copied into the frame's render data and written into a stream buffer
+// on the render thread, so no draw waits for the last frame's.
+class OpenGLDebugDraw
+{
+public:
+	explicit OpenGLDebugDraw(OpenGLStateCache& stateCache);
+
+	OpenGLDebugDraw(const OpenGLDebugDraw& other) = delete;
+	OpenGLDebugDraw& operator=(const OpenGLDebugDraw& other) = delete;
+
+	/// <summary> Starts a frame's shapes, culled to viewBounds. Game thread only. </summary>
+	void beginFrame(const OpenGLBounds& viewBounds);
+
+	// game thread only
+	void addSegment(vec2 p1, vec2 p2, Color color);
+	void addLineStrip(const vec2* verts, uint32 numVerts, Color color);
+	void addLineLoop(const vec2* verts, uint32 numVerts, Color color);
+
+	/// <summary> Fills the convex polygon at half strength and outlines it at full. </summary>
+	void addSolidPolygon(const vec2* verts, uint32 numVerts, Color color);
+
+	/// <summary> This frame's lines, two vertices a segment. Game thread only. </summary>
+	const std::vector<OpenGLDebugVertex>& getLines() const { return lines; }
+
+	/// <summary> This frame's triangles, three vertices each. Game thread only. </summary>
+	const std::vector<OpenGLDebugVertex>& getTriangles() const { return triangles; }
+
+	/// <summary> Gets what the last recorded frame added. Game thread only. </summary>
+	const RenderDebugDrawStats& getStats() const { return lastStats; }
+
+	/// <summary> Writes both streams into the stream buffer and draws them, triangles first so the outlines
+	/// end up on top. The debug draw material has to be in use. Render thread only. </summary>
+	void draw(const OpenGLDebugVertex* lineVerts,
+		size_t numLineVerts,
+		const OpenGLDebugVertex* triangleVerts,
+		size_t numTriangleVerts);
+
+	/// <summary> Hands the stream buffer and its vertex array to the deletion queue. Render thread only.
+	/// </summary>
+	void releaseBuffers(OpenGLDeletionQueue& deletionQueue);
+
+private:
+	static uint32 packColor(Color color);
+
+	/// <summary> Counts the shape, and if it is on screen. </summary>
+	bool isVisible(const vec2* verts, uint32 numVerts);
+
+	void appendLoop(const vec2* verts, uint32 numVerts, uint32 packedColor);
+
+	OpenGLStateCache& stateCache;
+
+	// game thread
+	OpenGLBounds viewBounds;
+	std::vector<OpenGLDebugVertex> lines;
+	std::vector<OpenGLDebugVertex> triangles;
+	RenderDebugDrawStats stats;
+	RenderDebugDrawStats lastStats;
+
+	// render thread
+	GLuint vertexArray;
+	OpenGLStreamBuffer vertices;
+};
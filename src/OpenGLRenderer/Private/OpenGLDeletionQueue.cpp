@@ -0,0 +1,128 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLDeletionQueue.h"
+
+#include "OpenGLStateCache.h"
+
+OpenGLDeletionQueue::OpenGLDeletionQueue(OpenGLStateCache& stateCache)
+	: stateCache(stateCache)
+	, numRetired(0)
+	, numFreed(0)
+	, numBatchesFreed(0)
+{
+	pending.fence = nullptr;
+}
+
+OpenGLDeletionQueue::~OpenGLDeletionQueue()
+{
+	// the context is on its way out, nothing left to free
+	assert(inFlight.empty());
+}
+
+void OpenGLDeletionQueue::retire(OpenGLObjectType type, GLuint name)
+{
+	if (name == 0) return;
+
+	pending.names[static_cast<size_t>(type)].push_back(name);
+	++numRetired;
+}
+
+void OpenGLDeletionQueue::endFrame()
+{
+	bool bHasPending = false;
+	for (auto&& names : pending.names) {
+		bHasPending |= !names.empty();
+	}
+
+	if (bHasPending) {
+		pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		inFlight.push_back(std::move(pending));
+
+		if (!spareBatches.empty()) {
+			pending = std::move(spareBatches.back());
+			spareBatches.pop_back();
+		}
+		else
+		{
+			pending = Batch();
+		}
+		pending.fence = nullptr;
+	}
+
+	// fences are passed in order, so stop at the first one that hasn't been
+	while (!inFlight.empty()) {
+		GLenum status = glClientWaitSync(inFlight.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+		freeBatch(inFlight.front());
+
+		spareBatches.push_back(std::move(inFlight.front()));
+		inFlight.pop_front();
+	}
+}
+
+void OpenGLDeletionQueue::flush()
+{
+	glFinish();
+
+	for (auto&& batch : inFlight) {
+		freeBatch(batch);
+	}
+	inFlight.clear();
+
+	pending.fence = nullptr;
+	freeBatch(pending);
+}
+
+OpenGLDeletionStats OpenGLDeletionQueue::getStats() const
+{
+	OpenGLDeletionStats ret;
+
+	ret.numRetired = numRetired;
+	ret.numFreed = numFreed;
+	ret.numBatchesFreed = numBatchesFreed;
+	ret.numBatchesPending = inFlight.size();
+
+	return ret;
+}
+
+void OpenGLDeletionQueue::freeBatch(Batch& batch)
+{
+	if (batch.fence) {
+		glDeleteSync(batch.fence);
+		batch.fence = nullptr;
+	}
+
+	bool bhadNames = false;
+	for (size_t type = 0; type < static_cast<size_t>(OpenGLObjectType::NUM_TYPES); ++type) {
+		auto&& names = batch.names[type];
+		if (names.empty()) continue;
+
+		auto count = static_cast<GLsizei>(names.size());
+		switch (static_cast<OpenGLObjectType>(type))
+		{
+		case OpenGLObjectType::BUFFER: glDeleteBuffers(count, names.data()); break;
+		case OpenGLObjectType::VERTEX_ARRAY: glDeleteVertexArrays(count, names.data()); break;
+		case OpenGLObjectType::TEXTURE: glDeleteTextures(count, names.data()); break;
+		case OpenGLObjectType::PROGRAM:
+			// there is no bulk delete for programs
+			for (auto&& name : names) {
+				glDeleteProgram(name);
+			}
+			break;
+		case OpenGLObjectType::FRAMEBUFFER: glDeleteFramebuffers(count, names.data()); break;
+		case OpenGLObjectType::RENDERBUFFER: glDeleteRenderbuffers(count, names.data()); break;
+		default: break;
+		}
+
+		stateCache.onDeleted(static_cast<OpenGLObjectType>(type), names.data(), names.size());
+
+		numFreed += names.size();
+		bhadNames = true;
+
+		names.clear();
+	}
+
+	if (bhadNames) ++numBatchesFreed;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <deque>
+#include <vector>
+
+class OpenGLStateCache;
+
+enum class OpenGLObjectType : uint8
+{
+	BUFFER = 0,
+	VERTEX_ARRAY = 1,
+	TEXTURE = 2,
+	PROGRAM = 3,
+	FRAMEBUFFER = 4,
+	RENDERBUFFER = 5,
+	NUM_TYPES = 6
+};
+
+struct OpenGLDeletionStats
+{
+	uint64 numRetired;		  // names handed to retire
+	uint64 numFreed;		  // names actually deleted
+	uint64 numBatchesFreed;	  // fenced batches that had anything to delete
+	size_t numBatchesPending; // fences the GPU hasn't passed yet
+};
+
+// Holds on to GL names that have been destroyed until the GPU is done with every frame that could use them.
+// Everything retired during a frame goes into one batch behind a fence at the end of that frame, and batches
+// are freed in bulk once their fence has been passed. The state cache hears about every name that is freed.
+// Render thread only.
+class OpenGLDeletionQueue
+{
+public:
+	explicit OpenGLDeletionQueue(OpenGLStateCache& stateCache);
+	~OpenGLDeletionQueue();
+
+	OpenGLDeletionQueue(const OpenGLDeletionQueue& other) = delete;
+	OpenGLDeletionQueue& operator=(const OpenGLDeletionQueue& other) = delete;
+
+	/// <summary> Queues a name to be deleted once the GPU has passed the end of this frame. 0 is ignored.
+	/// </summary>
+	void retire(OpenGLObjectType type, GLuint name);
+
+	/// <summary> Fences off what was retired this frame and frees every batch the GPU is done with. Call
+	/// after the frame's last command. </summary>
+	void endFrame();
+
+	/// <summary> Waits for the GPU and frees everything. </summary>
+	void flush();
+
+	OpenGLDeletionStats getStats() const;
+
+private:
+	struct Batch
+	{
+		GLsync fence;
+		std::vector<GLuint> names[static_cast<size_t>(OpenGLObjectType::NUM_TYPES)];
+	};
+
+	void freeBatch(Batch& batch);
+
+	OpenGLStateCache& stateCache;
+
+	Batch pending;
+	std::deque<Batch> inFlight;
+
+	// emptied batches, kept around so their vectors don't have to allocate again
+	std::vector<Batch> spareBatches;
+
+	uint64 numRetired;
+	uint64 numFreed;
+	uint64 numBatchesFreed;
+};
@@ -4,128 +4,89 @@
 #include "OpenGLTexture.h"
 #include "OpenGLRenderer.h"
 #include "OpenGLMaterialSource.h"
-#include "OpenGLTextBoxWidget.h"
 
 #include <boost/filesystem/fstream.hpp>
 
 #include <boost/archive/xml_wiarchive.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/unordered_map.hpp>
-#include <SOIL/SOIL.h>
 
 #include <string>
+#include <unordered_map>
 
 OpenGLFont::OpenGLFont(OpenGLRenderer& rendererIn, const path_t& name)
 	: fontName(name)
+	, matSource(nullptr)
+	, texUniLoc(-1)
 	, renderer(rendererIn)
 {
 	if (fontName.empty()) return;
 
-	// load the drawData
+	// the glyph table is baked from drawData the first time, and again whenever drawData is newer
 	{
 		path_t drawDataPath = L"fonts\\" + fontName.wstring() + L"\\drawData.txt";
-		assert(boost::filesystem::exists(drawDataPath));
+		path_t glyphsPath = L"fonts\\" + fontName.wstring() + L"\\font.glyphs";
 
-		boost::filesystem::wifstream i_stream{drawDataPath};
+		namespace fs = boost::filesystem;
+		bool bisStale = !fs::exists(glyphsPath)
+			|| (fs::exists(drawDataPath) && fs::last_write_time(drawDataPath) > fs::last_write_time(glyphsPath));
+		if (bisStale) bakeGlyphs(drawDataPath, glyphsPath);
 
-		if (!i_stream.is_open()) MFLOG(Error) << "Failed to open draw data for font" << fontName;
-
-		try
-		{
-
-			boost::archive::xml_wiarchive i_arch{i_stream};
-
-			i_arch >> boost::serialization::make_nvp("charData", charData);
-		}
-		catch (boost::archive::archive_exception& e)
-		{
-			MFLOG(Error) << "Archive exception while loading font " << fontName << " Error: " << e.what();
-		}
-		catch (std::runtime_error& e)
-		{
-			MFLOG(Error) << "Failed to load font " << fontName << " Error: " << e.what();
-		}
+		if (!glyphs.open(glyphsPath)) MFLOG(Error) << "Failed to load glyphs for font " << fontName;
 	}
-	using namespace std::string_literals;
-
-	renderer.runOnRenderThreadSync([this]
-		{
 
-			path_t ddsPath = L"fonts\\" + fontName.wstring() + L"\\font.dds";
-			assert(boost::filesystem::exists(ddsPath));
+	using namespace std::string_literals;
 
-			tex = SOIL_load_OGL_texture(ddsPath.string().c_str(),
-				1,							// 1 channel
-				0,							// create a new texture
-				SOIL_FLAG_DDS_LOAD_DIRECT); // load it from dds
+	// the caches aren't thread safe, so this has to happen here
+	matSource = static_cast<OpenGLMaterialSource*>(renderer.getMaterialSource("font"));
 
-			matSource = static_cast<OpenGLMaterialSource*>(renderer.getMaterialSource("font"));
+	// decoded on the texture loader's workers, like any other texture
+	texture = std::make_unique<OpenGLTexture>(renderer);
+	texture->initFromFile(L"fonts\\" + fontName.wstring() + L"\\font");
 
-			cutoffUniLoc = glGetUniformLocation(**matSource, "cutoff");
-			viewMatUniLoc = glGetUniformLocation(**matSource, "viewMat");
-			colorUniLoc = glGetUniformLocation(**matSource, "forgroundColor");
-		});
-}
-
-OpenGLFont::~OpenGLFont()
-{
-	renderer.runOnRenderThreadSync([this]
+	renderer.runOnRenderThreadDetached([this]
 		{
-			glDeleteTextures(1, &tex);
+			texUniLoc = glGetUniformLocation(**matSource, "tex");
 		});
 }
 
-OpenGLCharacterData OpenGLFont::getCharacterData(wchar_t ch)
-{
-	auto iter = charData.find(ch);
-
-	if (iter != charData.end()) {
-		return iter->second;
-	}
-
-	MFLOG(Error) << "Cannot find char " << ch << " in font " << fontName;
-
-	return OpenGLCharacterData();
-}
+// the texture hands its name back to the render thread itself
+OpenGLFont::~OpenGLFont() = default;
 
 OpenGLMaterialSource* OpenGLFont::getMaterialSource() { return matSource; }
 
-void OpenGLFont::render(OpenGLTextBoxWidget& box, const mat3& mat)
+bool OpenGLFont::bakeGlyphs(const path_t& drawDataPath, const path_t& glyphsPath)
 {
-	auto matID = **matSource;
-
-	renderer.runOnRenderThreadAsync([this, matID, &box, mat]
-		{
-
-			glUseProgram(matID);
+	boost::filesystem::wifstream i_stream{drawDataPath};
 
-			assert(cutoffUniLoc != -1);
-			glUniform1f(cutoffUniLoc, box.thickness);
-
-			assert(viewMatUniLoc != -1);
-			glUniformMatrix3fv(viewMatUniLoc, 1, GL_FALSE, &mat[0][0]);
-
-			assert(colorUniLoc != -1);
-			glUniform4f(colorUniLoc, box.color.r, box.color.g, box.color.b, box.color.a);
-
-			glUniform1i(glGetUniformLocation(matID, "tex"), 0);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, tex);
+	if (!i_stream.is_open()) {
+		MFLOG(Warning) << "Failed to open draw data for font" << fontName;
+		return false;
+	}
 
-			glBindVertexArray(box.vertexArray);
+	std::unordered_map<wchar_t, OpenGLCharacterData> charData;
 
-			glEnableVertexAttribArray(0);
-			glBindBuffer(GL_ARRAY_BUFFER, box.vertLocBuffer);
-			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	try
+	{
+		boost::archive::xml_wiarchive i_arch{i_stream};
 
-			glEnableVertexAttribArray(1);
-			glBindBuffer(GL_ARRAY_BUFFER, box.texCoordBuffer);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+		i_arch >> boost::serialization::make_nvp("charData", charData);
+	}
+	catch (boost::archive::archive_exception& e)
+	{
+		MFLOG(Warning) << "Archive exception while loading font " << fontName << " Error: " << e.what();
+		return false;
+	}
+	catch (std::runtime_error& e)
+	{
+		MFLOG(Warning) << "Failed to load font " << fontName << " Error: " << e.what();
+		return false;
+	}
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, box.elemBuffer);
-			glDrawElements(GL_TRIANGLES, (GLsizei)box.text.size() * 2 * 3, GL_UNSIGNED_INT, 0);
+	if (!OpenGLGlyphTable::bake(charData, glyphsPath)) {
+		MFLOG(Warning) << "Failed to write glyphs for font " << fontName;
+		return false;
+	}
 
-			glDisableVertexAttribArray(0);
-			glDisableVertexAttribArray(1);
-		});
+	return true;
 }
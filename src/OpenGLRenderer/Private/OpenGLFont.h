@@ -2,16 +2,16 @@
 #include "OpenGLRendererConfig.h"
 
 #include "OpenGLCharacterData.h"
+#include "OpenGLGlyphTable.h"
 
 #include <Font.h>
 
-#include <unordered_map>
+#include <memory>
 #include <string>
 
 class OpenGLMaterialSource;
 class OpenGLTexture;
 class OpenGLRenderer;
-class OpenGLTextBoxWidget;
 
 class OpenGLFont : public Font
 {
@@ -22,21 +22,28 @@ public:
 
 	virtual ~OpenGLFont();
 
-	OpenGLCharacterData getCharacterData(wchar_t ch);
+	/// <summary> How to draw ch. Characters the font doesn't have get its replacement glyph. </summary>
+	OpenGLCharacterData getCharacterData(wchar_t ch) const { return glyphs[ch]; }
+
 	OpenGLMaterialSource* getMaterialSource();
 
-	void render(OpenGLTextBoxWidget& box, const mat3& mat);
+	/// <summary> The glyph atlas. </summary>
+	OpenGLTexture& getTexture() { return *texture; }
+
+	/// <summary> Where the atlas sampler is. Render thread only, once the program is resident. </summary>
+	GLint getTexUniformLocation() const { return texUniLoc; }
 
 private:
+	/// <summary> Turns the drawData.txt FontGenerator makes into a glyph table at glyphsPath. </summary>
+	bool bakeGlyphs(const path_t& drawDataPath, const path_t& glyphsPath);
+
 	path_t fontName;
 
-	std::unordered_map<wchar_t, OpenGLCharacterData> charData;
+	OpenGLGlyphTable glyphs;
 
 	OpenGLMaterialSource* matSource;
-	GLuint tex;
-	GLint cutoffUniLoc;
-	GLint colorUniLoc;
-	GLint viewMatUniLoc;
+	std::unique_ptr<OpenGLTexture> texture;
+	GLint texUniLoc;
 
 	OpenGLRenderer& renderer;
 };
@@ -0,0 +1,157 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLGlyphTable.h"
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// what every character is before a table is open
+const uint16 emptyFlat[OpenGLGlyphTable::numFlat] = {};
+const OpenGLGlyphTable::Glyph emptyGlyph = {};
+}
+
+OpenGLGlyphTable::OpenGLGlyphTable()
+	: flat(emptyFlat)
+	, ranges(nullptr)
+	, glyphs(&emptyGlyph)
+	, numRanges(0)
+	, replacement(0)
+{
+}
+
+OpenGLGlyphTable::Glyph OpenGLGlyphTable::Glyph::fromCharacterData(const OpenGLCharacterData& data)
+{
+	return Glyph{{data.uvBegin.x, data.uvBegin.y}, {data.uvEnd.x, data.uvEnd.y}, data.advance,
+		{data.offset.x, data.offset.y}, {data.size.x, data.size.y}};
+}
+
+bool OpenGLGlyphTable::open(const path_t& path)
+{
+	try
+	{
+		file.open(path);
+	}
+	catch (std::exception& e)
+	{
+		MFLOG(Warning) << "Failed to map glyph table " << path << " Error: " << e.what();
+		return false;
+	}
+
+	Header header;
+	if (file.size() < sizeof(header)) {
+		MFLOG(Warning) << "Not a glyph table this version can read: " << path;
+		file.close();
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	size_t flatOffset = sizeof(Header);
+	size_t rangesOffset = flatOffset + sizeof(uint16) * numFlat;
+	size_t glyphsOffset = rangesOffset + sizeof(Range) * header.numRanges;
+	size_t size = glyphsOffset + sizeof(Glyph) * header.numGlyphs;
+
+	if (std::strncmp(header.magic, "MFGT", 4) != 0 || header.version != currentVersion
+		|| header.replacement >= header.numGlyphs || file.size() < size) {
+		MFLOG(Warning) << "Not a glyph table this version can read: " << path;
+		file.close();
+		return false;
+	}
+
+	// the mapping starts on a page, and every part is laid out on a multiple of 4
+	auto fileFlat = reinterpret_cast<const uint16*>(file.data() + flatOffset);
+	auto fileRanges = reinterpret_cast<const Range*>(file.data() + rangesOffset);
+
+	// find indexes glyphs with these unchecked, so a table that points past its glyphs or has ranges out of
+	// order can't be used
+	bool bvalid = std::all_of(
+		fileFlat, fileFlat + numFlat, [&](uint16 glyph) { return glyph < header.numGlyphs; });
+	for (uint32 i = 0; bvalid && i < header.numRanges; ++i) {
+		auto&& range = fileRanges[i];
+
+		bvalid = range.first >= numFlat && range.first <= range.last && range.firstGlyph < header.numGlyphs
+			&& range.last - range.first < header.numGlyphs - range.firstGlyph
+			&& (i == 0 || fileRanges[i - 1].last < range.first);
+	}
+	if (!bvalid) {
+		MFLOG(Warning) << "Glyph table is corrupt: " << path;
+		file.close();
+		return false;
+	}
+
+	flat = fileFlat;
+	ranges = fileRanges;
+	glyphs = reinterpret_cast<const Glyph*>(file.data() + glyphsOffset);
+	numRanges = header.numRanges;
+	replacement = header.replacement;
+
+	return true;
+}
+
+bool OpenGLGlyphTable::bake(const std::unordered_map<wchar_t, OpenGLCharacterData>& charData, const path_t& path)
+{
+	std::vector<uint32> codepoints;
+	codepoints.reserve(charData.size());
+	for (auto&& entry : charData) codepoints.push_back(static_cast<uint32>(entry.first));
+	std::sort(codepoints.begin(), codepoints.end());
+
+	// glyphs go in codepoint order, so a run of codepoints past the flat table is one range
+	std::vector<Glyph> glyphs;
+	std::vector<Range> ranges;
+	glyphs.reserve(codepoints.size() + 1);
+	for (auto codepoint : codepoints) {
+		if (codepoint >= numFlat) {
+			if (ranges.empty() || ranges.back().last + 1 != codepoint) {
+				ranges.push_back(Range{codepoint, codepoint, static_cast<uint32>(glyphs.size())});
+			}
+			else
+			{
+				ranges.back().last = codepoint;
+			}
+		}
+
+		glyphs.push_back(Glyph::fromCharacterData(charData.at(static_cast<wchar_t>(codepoint))));
+	}
+
+	Header header;
+	std::memcpy(header.magic, "MFGT", 4);
+	header.version = currentVersion;
+	header.numRanges = static_cast<uint32>(ranges.size());
+
+	auto question = std::lower_bound(codepoints.begin(), codepoints.end(), uint32('?'));
+	if (question != codepoints.end() && *question == '?') {
+		header.replacement = static_cast<uint32>(question - codepoints.begin());
+	}
+	else
+	{
+		header.replacement = static_cast<uint32>(glyphs.size());
+		glyphs.push_back(Glyph{});
+	}
+	header.numGlyphs = static_cast<uint32>(glyphs.size());
+
+	if (glyphs.size() > std::numeric_limits<uint16>::max()) {
+		MFLOG(Warning) << "Too many glyphs for a glyph table: " << path;
+		return false;
+	}
+
+	uint16 flat[numFlat];
+	std::fill(std::begin(flat), std::end(flat), static_cast<uint16>(header.replacement));
+	for (size_t i = 0; i < codepoints.size() && codepoints[i] < numFlat; ++i) {
+		flat[codepoints[i]] = static_cast<uint16>(i);
+	}
+
+	boost::filesystem::ofstream stream{path, std::ios::binary};
+	if (!stream.is_open()) return false;
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char*>(flat), sizeof(flat));
+	stream.write(reinterpret_cast<const char*>(ranges.data()), sizeof(Range) * ranges.size());
+	stream.write(reinterpret_cast<const char*>(glyphs.data()), sizeof(Glyph) * glyphs.size());
+
+	return static_cast<bool>(stream);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLCharacterData.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// A font's metrics as they sit in font.glyphs, mapped straight into memory. ASCII and Latin-1 look their
+// glyph up in a flat table, and anything past that binary searches a short list of codepoint ranges.
+// Characters the font doesn't have get its replacement glyph -- '?' if it has one, an empty glyph otherwise.
+//
+// On disk it is the header, then the flat table, then the ranges, sorted, then the glyphs.
+class OpenGLGlyphTable
+{
+public:
+	struct Header
+	{
+		char magic[4]; // "MFGT"
+		uint32 version;
+		uint32 numGlyphs;
+		uint32 numRanges;
+		uint32 replacement; // the glyph for characters that aren't in the font
+	};
+
+	struct Range
+	{
+		uint32 first; // codepoints, both inclusive
+		uint32 last;
+		uint32 firstGlyph;
+	};
+
+	// OpenGLCharacterData as plain floats -- glm's vectors aren't trivially copyable, so they can't be read in
+	// place
+	struct Glyph
+	{
+		float uvBegin[2];
+		float uvEnd[2];
+		float advance;
+		float offset[2];
+		float size[2];
+
+		static Glyph fromCharacterData(const OpenGLCharacterData& data);
+		OpenGLCharacterData toCharacterData() const
+		{
+			return OpenGLCharacterData{vec2{uvBegin[0], uvBegin[1]}, vec2{uvEnd[0], uvEnd[1]}, advance,
+				vec2{offset[0], offset[1]}, vec2{size[0], size[1]}};
+		}
+	};
+
+	static const uint32 currentVersion = 1;
+	static const uint32 numFlat = 256; // ASCII and Latin-1
+
+	static_assert(std::is_trivially_copyable<Glyph>::value, "glyphs are read in place");
+
+	OpenGLGlyphTable();
+
+	/// <summary> Maps path. Until it has, or if it can't be, every character is an empty glyph. </summary>
+	///
+	/// <returns> If path could be mapped and is a glyph table this version understands. </returns>
+	bool open(const path_t& path);
+
+	/// <summary> Lays charData out as a glyph table and writes it to path. </summary>
+	///
+	/// <returns> If it could be written. </returns>
+	static bool bake(const std::unordered_map<wchar_t, OpenGLCharacterData>& charData, const path_t& path);
+
+	OpenGLCharacterData operator[](wchar_t ch) const { return glyphs[find(ch)].toCharacterData(); }
+
+private:
+	/// <summary> Where ch's glyph is in glyphs. </summary>
+	uint32 find(wchar_t ch) const
+	{
+		uint32 codepoint = static_cast<uint32>(ch);
+		if (codepoint < numFlat) return flat[codepoint];
+
+		// the last range starting at or before it
+		auto range = std::upper_bound(
+			ranges, ranges + numRanges, codepoint, [](uint32 codepoint, const Range& range)
+			{
+				return codepoint < range.first;
+			});
+		if (range == ranges || codepoint > (--range)->last) return replacement;
+
+		return range->firstGlyph + codepoint - range->first;
+	}
+
+	boost::iostreams::mapped_file_source file;
+
+	// into file, or the empty glyph
+	const uint16* flat;
+	const Range* ranges;
+	const Glyph* glyphs;
+	uint32 numRanges;
+	uint32 replacement;
+};
@@ -2,6 +2,7 @@
 
 #include "OpenGLMaterialInstance.h"
 #include "OpenGLTexture.h"
+#include "OpenGLTextureLibrary.h"
 #include "OpenGLMaterialSource.h"
 #include "OpenGLRenderer.h"
 
@@ -11,24 +12,62 @@
 
 #include <OpenGLTexture.h>
 
+#include <cstring>
+
+#include <boost/functional/hash.hpp>
+
 OpenGLMaterialInstance::OpenGLMaterialInstance(OpenGLRenderer& renderer, MaterialSource* source)
 	: renderer(renderer)
+	, lastUpdatedFrame(~0ull)
+	, bisTexturesDirty(false)
+	, bisLayoutDirty(true)
+	, parameterBuffer(0)
+	, batchSignature(0)
 {
+	textures.states.fill(nullptr);
+	textures.targets.fill(GL_TEXTURE_2D);
+	renderTextures = textures;
+	instanceProperties.fill(0);
+
 	if (source) init(source);
 }
 
-OpenGLMaterialInstance::~OpenGLMaterialInstance() {}
+OpenGLMaterialInstance::~OpenGLMaterialInstance()
+{
+	// instances are kept alive by their models until the frames drawing them are done, so nothing on the
+	// render thread can still be using this
+	renderer.retireGLObject(OpenGLObjectType::BUFFER, parameterBuffer);
+}
 
+// the render thread only sees these once they go out in a packet, so frames already recorded keep drawing
+// with the textures they were recorded with
 void OpenGLMaterialInstance::setTexture(uint32 ID, Texture* texture)
 {
 	assert(texture);
-	textures[ID] = static_cast<OpenGLTexture*>(texture);
+	textures.states[ID] = getState(texture, textures.targets[ID]);
+	bisTexturesDirty = true;
 }
 
 void OpenGLMaterialInstance::setTexture(uint32 ID, std::shared_ptr<Texture> texture)
 {
 	assert(texture);
-	refCountedTextures[ID] = std::static_pointer_cast<OpenGLTexture>(texture);
+	textures.states[ID] = getState(texture.get(), textures.targets[ID]);
+	bisTexturesDirty = true;
+
+	// frames in flight can still bind the one it replaces
+	renderer.retireFrameResource(std::move(refCountedTextures[ID]));
+	refCountedTextures[ID] = std::move(texture);
+}
+
+OpenGLTextureState* OpenGLMaterialInstance::getState(Texture* texture, GLenum& target)
+{
+	if (auto library = dynamic_cast<OpenGLTextureLibrary*>(texture)) {
+		target = GL_TEXTURE_2D_ARRAY;
+		return library->getState();
+	}
+
+	target = GL_TEXTURE_2D;
+	return static_cast<OpenGLTexture*>(texture)->getState();
 }
 
 void OpenGLMaterialInstance::init(MaterialSource* source)
@@ -47,262 +86,375 @@ void OpenGLMaterialInstance::setUpdateCallback(std::function<void(MaterialInstan
 // start property interface
 void OpenGLMaterialInstance::setProperty(const std::string& propName, int32 i)
 {
-
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]()
-			{
-				assert(loc != -1);
-				glUniform1i(loc, i);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::INT), MaterialPropertyType::INT, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const ivec2& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform2i(loc, i.x, i.y);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::IVEC2), MaterialPropertyType::IVEC2, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const ivec3& i)
 {
-
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform3i(loc, i.x, i.y, i.z);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::IVEC3), MaterialPropertyType::IVEC3, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const ivec4& i)
 {
-
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]()
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform4i(loc, i.x, i.y, i.z, i.w);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::IVEC4), MaterialPropertyType::IVEC4, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, int* i, size_t size)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i, size]
-		{
-			switch (size)
-			{
-			case 1:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform1iv(loc, 1, i);
-				};
-				break;
-			case 2:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform2iv(loc, 1, i);
-				};
-				break;
-			case 3:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform3iv(loc, 1, i);
-				};
-				break;
-			case 4:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform4iv(loc, 1, i);
-				};
-				break;
-			}
-		});
+	assert(size >= 1 && size <= 4);
+
+	static const MaterialPropertyType types[] = {MaterialPropertyType::INT,
+		MaterialPropertyType::IVEC2,
+		MaterialPropertyType::IVEC3,
+		MaterialPropertyType::IVEC4};
+	watchProperty(propName, types[size - 1], i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, float i)
 {
-
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform1f(loc, i);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::FLOAT), MaterialPropertyType::FLOAT, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const vec2& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform2f(loc, i.x, i.y);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::VEC2), MaterialPropertyType::VEC2, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const vec3& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform3f(loc, i.x, i.y, i.z);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::VEC3), MaterialPropertyType::VEC3, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, const vec4& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniform4f(loc, i.x, i.y, i.z, i.w);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::VEC4), MaterialPropertyType::VEC4, &i);
 }
 void OpenGLMaterialInstance::setProperty(const std::string& propName, float* i, size_t size)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i, size]
-		{
-			switch (size)
-			{
-			case 1:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform1fv(loc, 1, i);
-				};
-				break;
-			case 2:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform2fv(loc, 1, i);
-				};
-				break;
-			case 3:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform3fv(loc, 1, i);
-				};
-				break;
-			case 4:
-				properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-				{
-					assert(loc != -1);
-					glUniform4fv(loc, 1, i);
-				};
-				break;
-			}
-		});
+	assert(size >= 1 && size <= 4);
+
+	static const MaterialPropertyType types[] = {MaterialPropertyType::FLOAT,
+		MaterialPropertyType::VEC2,
+		MaterialPropertyType::VEC3,
+		MaterialPropertyType::VEC4};
+	watchProperty(propName, types[size - 1], i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix(const std::string& propName, const mat2& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix2fv(loc, 1, GL_FALSE, &i[0][0]);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::MAT2), MaterialPropertyType::MAT2, &i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix(const std::string& propName, const mat3& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix3fv(loc, 1, GL_FALSE, &i[0][0]);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::MAT3), MaterialPropertyType::MAT3, &i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix(const std::string& propName, const mat4& i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix4fv(loc, 1, GL_FALSE, &i[0][0]);
-			};
-		});
+	setPropertyValue(getPropertyID(propName, MaterialPropertyType::MAT4), MaterialPropertyType::MAT4, &i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix2ptr(const std::string& propName, float* i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix2fv(loc, 1, GL_FALSE, i);
-			};
-		}); // fds fdas
+	watchProperty(propName, MaterialPropertyType::MAT2, i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix3ptr(const std::string& propName, float* i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix3fv(loc, 1, GL_FALSE, i);
-			};
-		});
+	watchProperty(propName, MaterialPropertyType::MAT3, i);
 }
 void OpenGLMaterialInstance::setPropertyMatrix4ptr(const std::string& propName, float* i)
 {
-	renderer.runOnRenderThreadAsyncOrSync([this, propName, i]
-		{
-			properties[propName] = [ i, loc = glGetUniformLocation(**program, propName.c_str()) ]
-			{
-				assert(loc != -1);
-				glUniformMatrix4fv(loc, 1, GL_FALSE, i);
-			};
-		});
+	watchProperty(propName, MaterialPropertyType::MAT4, i);
 }
 // end property interface
 
+void OpenGLMaterialInstance::setPropertyValue(uint32 ID, MaterialPropertyType type, const void* value)
+{
+	if (ID == invalidMaterialPropertyID) return;
+
+	// only grows the first time each property is set
+	if (ID >= values.size()) {
+		values.resize(ID + 1);
+		valueStates.resize(ID + 1, ValueState::UNSET);
+	}
+
+	auto&& bytes = values[ID].bytes;
+	auto size = getPropertySize(type);
+
+	if (valueStates[ID] != ValueState::UNSET && std::memcmp(bytes.data(), value, size) == 0) return;
+
+	std::memcpy(bytes.data(), value, size);
+
+	if (valueStates[ID] != ValueState::DIRTY) {
+		valueStates[ID] = ValueState::DIRTY;
+		dirtyIDs.push_back(ID);
+	}
+}
+
+const OpenGLPropertyUpdate* OpenGLMaterialInstance::takePropertyUpdates(uint32& numUpdates)
+{
+	// later draws of it this frame only pick up what the models' own code set in between
+	auto frame = renderer.getFramesSubmitted();
+	if (frame != lastUpdatedFrame) {
+		lastUpdatedFrame = frame;
+
+		if (updateCallback) updateCallback(*this);
+
+		for (auto&& watched : watchedProperties) {
+			setPropertyValue(watched.ID, watched.type, watched.value);
+		}
+	}
+
+	numUpdates = static_cast<uint32>(dirtyIDs.size());
+	if (numUpdates == 0) return nullptr;
+
+	auto updates = renderer.allocateRenderData<OpenGLPropertyUpdate>(numUpdates);
+	for (uint32 i = 0; i < numUpdates; ++i) {
+		auto ID = dirtyIDs[i];
+
+		updates[i].ID = ID;
+		updates[i].value = values[ID];
+
+		valueStates[ID] = ValueState::CLEAN;
+	}
+	dirtyIDs.clear();
+
+	return updates;
+}
+
+void OpenGLMaterialInstance::applyPropertyUpdates(const OpenGLPropertyUpdate* updates, uint32 numUpdates)
+{
+	assert(renderer.isOnRenderThread());
+
+	for (uint32 i = 0; i < numUpdates; ++i) {
+		auto ID = updates[i].ID;
+
+		if (ID >= renderValues.size()) {
+			renderValues.resize(ID + 1);
+			renderValueSet.resize(ID + 1, false);
+		}
+
+		renderValues[ID] = updates[i].value;
+		renderValueSet[ID] = true;
+	}
+
+	if (numUpdates != 0) bisLayoutDirty = true;
+}
+
+const OpenGLTextureBindings* OpenGLMaterialInstance::takeTextureBindings()
+{
+	if (!bisTexturesDirty) return nullptr;
+
+	auto bindings = renderer.allocateRenderData<OpenGLTextureBindings>(1);
+	*bindings = textures;
+	bisTexturesDirty = false;
+
+	return bindings;
+}
+
+void OpenGLMaterialInstance::applyTextureBindings(const OpenGLTextureBindings& bindings)
+{
+	assert(renderer.isOnRenderThread());
+
+	renderTextures = bindings;
+	bisLayoutDirty = true; // the signature has them in it
+}
+
+void OpenGLMaterialInstance::update()
+{
+	assert(renderer.isOnRenderThread());
+	assert(program && program->isResident());
+
+	if (!bisLayoutDirty) return;
+
+	using Kind = OpenGLMaterialSource::PropertyBinding::Kind;
+
+	parameterBlock.resize(program->getParameterBlockSize());
+	uniformValues.clear();
+
+	for (uint32 ID = 0; ID < renderValues.size(); ++ID) {
+		if (!renderValueSet[ID]) continue;
+
+		auto&& binding = program->getPropertyBinding(ID);
+		auto&& value = renderValues[ID];
+
+		switch (binding.kind)
+		{
+		case Kind::PARAMETER_BLOCK: writeParameter(binding, value); break;
+		case Kind::INSTANCE:
+			// int or float, either way it's 4 bytes
+			std::memcpy(&instanceProperties[binding.slot], value.bytes.data(), sizeof(uint32));
+			break;
+		case Kind::UNIFORM:
+			uniformValues.push_back(UniformValue{binding.location, binding.type, value});
+			break;
+		default: break;
+		}
+	}
+
+	// one buffer per instance, only touched when something in it changed
+	if (!parameterBlock.empty()) {
+		if (parameterBuffer == 0) {
+			glGenBuffers(1, &parameterBuffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, parameterBuffer);
+			glBufferData(GL_UNIFORM_BUFFER, parameterBlock.size(), parameterBlock.data(), GL_DYNAMIC_DRAW);
+		}
+		else
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, parameterBuffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, parameterBlock.size(), parameterBlock.data());
+		}
+	}
+
+	updateBatchSignature();
+
+	bisLayoutDirty = false;
+}
+
 void OpenGLMaterialInstance::use()
 {
 	assert(renderer.isOnRenderThread());
 
-	if (updateCallback) updateCallback(*this);
+	auto&& state = renderer.getStateCache();
+	auto&& residency = renderer.getTextureResidency();
 
 	assert(program);
 	assert(glIsProgram(**program));
-	glUseProgram(**program);
-	for (auto&& elem : properties) {
-		elem.second();
+	state.useProgram(**program);
+
+	for (auto&& uniform : uniformValues) {
+		setUniform(state, uniform);
+	}
+
+	if (parameterBuffer != 0) {
+		state.bindUniformBuffer(OpenGLMaterialSource::parameterBlockBinding, parameterBuffer);
 	}
 
-	for (uint32 i = 0; i < maxTextures && textures[i]; i++) {
-		glUniform1i(program->startTexUniform + i, i);
+	for (uint32 i = 0; i < maxTextures && renderTextures.states[i]; i++) {
+		auto&& texture = *renderTextures.states[i];
+		residency.touch(texture);
 
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, textures[i]->getID());
+		bool bisArray = renderTextures.targets[i] == GL_TEXTURE_2D_ARRAY;
+
+		GLint unit = i;
+		GLint startLocation = bisArray ? program->startTexArrayUniform : program->startTexUniform;
+		if (startLocation != -1) {
+			GLint location = startLocation + i;
+			if (state.shouldSetUniform(location, &unit, sizeof(unit))) glUniform1i(location, unit);
+		}
+
+		if (bisArray) {
+			state.bindTextureArray(i, texture.ID);
+		}
+		else
+		{
+			state.bindTexture(i, texture.ID);
+		}
 	}
+}
+
+uint32 OpenGLMaterialInstance::getPropertyID(const std::string& propName, MaterialPropertyType type)
+{
+	assert(program);
+	return program->getPropertyID(propName, type);
+}
+
+void OpenGLMaterialInstance::watchProperty(
+	const std::string& propName, MaterialPropertyType type, const void* value)
+{
+	auto ID = getPropertyID(propName, type);
+	if (ID == invalidMaterialPropertyID) return;
+
+	bool bWasWatched = false;
+	for (auto&& watched : watchedProperties) {
+		if (watched.ID == ID) {
+			watched.value = value;
+			bWasWatched = true;
+		}
+	}
+	if (!bWasWatched) watchedProperties.push_back(WatchedProperty{ID, type, value});
+
+	setPropertyValue(ID, type, value);
+}
+
+void OpenGLMaterialInstance::writeParameter(
+	const OpenGLMaterialSource::PropertyBinding& binding, const OpenGLPropertyValue& value)
+{
+	uint8* dest = parameterBlock.data() + binding.offset;
+
+	// matrix columns are padded out to the stride, so they go one at a time
+	uint32 columns = getPropertyColumns(binding.type);
+	if (columns == 0) {
+		std::memcpy(dest, value.bytes.data(), getPropertySize(binding.type));
+		return;
+	}
+
+	size_t columnSize = getPropertySize(binding.type) / columns;
+	for (uint32 column = 0; column < columns; ++column) {
+		auto source = value.bytes.data() + columnSize * column;
+		std::memcpy(dest + binding.matrixStride * column, source, columnSize);
+	}
+}
+
+void OpenGLMaterialInstance::setUniform(OpenGLStateCache& state, const UniformValue& uniform)
+{
+	auto data = uniform.value.bytes.data();
+	if (!state.shouldSetUniform(uniform.location, data, getPropertySize(uniform.type))) return;
+
+	auto ints = reinterpret_cast<const GLint*>(data);
+	auto floats = reinterpret_cast<const GLfloat*>(data);
+
+	switch (uniform.type)
+	{
+	case MaterialPropertyType::INT: glUniform1iv(uniform.location, 1, ints); break;
+	case MaterialPropertyType::IVEC2: glUniform2iv(uniform.location, 1, ints); break;
+	case MaterialPropertyType::IVEC3: glUniform3iv(uniform.location, 1, ints); break;
+	case MaterialPropertyType::IVEC4: glUniform4iv(uniform.location, 1, ints); break;
+	case MaterialPropertyType::FLOAT: glUniform1fv(uniform.location, 1, floats); break;
+	case MaterialPropertyType::VEC2: glUniform2fv(uniform.location, 1, floats); break;
+	case MaterialPropertyType::VEC3: glUniform3fv(uniform.location, 1, floats); break;
+	case MaterialPropertyType::VEC4: glUniform4fv(uniform.location, 1, floats); break;
+	case MaterialPropertyType::MAT2: glUniformMatrix2fv(uniform.location, 1, GL_FALSE, floats); break;
+	case MaterialPropertyType::MAT3: glUniformMatrix3fv(uniform.location, 1, GL_FALSE, floats); break;
+	case MaterialPropertyType::MAT4: glUniformMatrix4fv(uniform.location, 1, GL_FALSE, floats); break;
+	default: break;
+	}
+}
+
+bool OpenGLMaterialInstance::drawsSameAs(const OpenGLMaterialInstance& other) const
+{
+	if (batchSignature != other.batchSignature || program != other.program) return false;
+
+	for (uint32 i = 0; i < maxTextures; i++) {
+		if (renderTextures.states[i] != other.renderTextures.states[i]) return false;
+		if (!renderTextures.states[i]) break;
+		if (renderTextures.targets[i] != other.renderTextures.targets[i]) return false;
+	}
+
+	if (parameterBlock != other.parameterBlock) return false;
+
+	if (uniformValues.size() != other.uniformValues.size()) return false;
+	for (size_t i = 0; i < uniformValues.size(); ++i) {
+		auto&& uniform = uniformValues[i];
+		auto&& otherUniform = other.uniformValues[i];
+
+		if (uniform.location != otherUniform.location || uniform.type != otherUniform.type) return false;
+		if (std::memcmp(uniform.value.bytes.data(), otherUniform.value.bytes.data(), getPropertySize(uniform.type))
+			!= 0)
+			return false;
+	}
+
+	return true;
+}
+
+void OpenGLMaterialInstance::updateBatchSignature()
+{
+	batchSignature = 0;
+	boost::hash_combine(batchSignature, program);
+	for (uint32 i = 0; i < maxTextures && renderTextures.states[i]; i++) {
+		boost::hash_combine(batchSignature, renderTextures.states[i]);
+	}
+
+	boost::hash_range(batchSignature, parameterBlock.begin(), parameterBlock.end());
 
-	for (uint32 i = 0; i < maxTextures && refCountedTextures[i]; i++) {
-		glUniform1i(program->startTexUniform + i, i);
+	for (auto&& uniform : uniformValues) {
+		auto bytes = uniform.value.bytes.data();
 
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, refCountedTextures[i]->getID());
+		boost::hash_combine(batchSignature, uniform.location);
+		boost::hash_range(batchSignature, bytes, bytes + getPropertySize(uniform.type));
 	}
 }
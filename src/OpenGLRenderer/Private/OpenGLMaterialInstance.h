@@ -1,9 +1,13 @@
 #pragma once
 #include "OpenGLRendererConfig.h"
 
+#include "OpenGLMaterialProperty.h"
+#include "OpenGLMaterialSource.h"
+
 #include <MaterialInstance.h>
 #include <Texture.h>
 
+#include <array>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -11,7 +15,9 @@
 #include <boost/optional.hpp>
 
 class OpenGLTexture;
+struct OpenGLTextureState;
 class OpenGLMaterialSource;
+class OpenGLStateCache;
 class OpenGLRenderer;
 
 class OpenGLMaterialInstance : public MaterialInstance
@@ -30,7 +36,8 @@ public:
 
 	virtual void setUpdateCallback(std::function<void(MaterialInstance&)>) override;
 
-	// property interface
+	// property interface -- these look the name up every time, so keep them out of per-frame code and use
+	// handles from the source there
 	virtual void setProperty(const std::string& propName, int32 i) override;
 	virtual void setProperty(const std::string& propName, const ivec2& i) override;
 	virtual void setProperty(const std::string& propName, const ivec3& i) override;
@@ -52,20 +59,134 @@ public:
 	virtual void setPropertyMatrix4ptr(const std::string& propName, float* i) override;
 	// end property interface
 
+	using MaterialInstance::setProperty;
+
+	virtual void setPropertyValue(uint32 ID, MaterialPropertyType type, const void* value) override;
+
+	/// <summary> Hands over everything that changed since the last call. The first call in a frame runs the
+	/// update callback and reads the properties that were set from pointers first, so a material shared by
+	/// many models only does that once. The updates live in the frame's render data. Game thread only, once
+	/// per draw. </summary>
+	///
+	/// <returns> The updates, or nullptr if nothing changed. </returns>
+	const OpenGLPropertyUpdate* takePropertyUpdates(uint32& numUpdates);
+
+	/// <summary> Takes in updates from takePropertyUpdates, in the order they were made. Render thread only,
+	/// whether or not this gets drawn. </summary>
+	void applyPropertyUpdates(const OpenGLPropertyUpdate* updates, uint32 numUpdates);
+
+	/// <summary> Hands over the textures if setTexture changed them since the last call. They live in the
+	/// frame's render data. Game thread only, once per draw. </summary>
+	///
+	/// <returns> The textures, or nullptr if they didn't change. </returns>
+	const OpenGLTextureBindings* takeTextureBindings();
+
+	/// <summary> The textures as the game thread has them now, for drawing outside of a frame. Game thread
+	/// only. </summary>
+	const OpenGLTextureBindings& getTextureBindings() const { return textures; }
+
+	/// <summary> Takes in textures from takeTextureBindings or getTextureBindings. Render thread only, whether
+	/// or not this gets drawn. </summary>
+	void applyTextureBindings(const OpenGLTextureBindings& bindings);
+
+	/// <summary> Lays the properties out for the shader if they changed -- into the parameter block, which
+	/// is uploaded then, the instance properties, or plain uniforms. Render thread only, once the source is
+	/// resident and before anything else here is read. </summary>
+	void update();
+
+	/// <summary> Binds the program, uniforms, parameter block and textures through the state cache, so
+	/// whatever the last material left the same isn't set again. Marks the textures used this frame, so the
+	/// residency keeps them. Render thread only. </summary>
 	void use();
 
+	/// <summary> Values of the properties the shader takes per instance, laid out like
+	/// OpenGLInstanceData::properties. Render thread only. </summary>
+	const std::array<uint32, OpenGLMaterialSource::maxInstanceProperties>& getInstanceProperties() const
+	{
+		return instanceProperties;
+	}
+
+	/// <summary> A hash of everything use() sets -- program, textures, the parameter block and uniform
+	/// values. Instances whose materials draw the same have the same one, but different ones can too, so
+	/// check drawsSameAs before batching them. Render thread only. </summary>
+	size_t getBatchSignature() const { return batchSignature; }
+
+	/// <summary> If use() would set exactly what it sets for other, so instances of both can be drawn
+	/// together. Render thread only, after update() on both. </summary>
+	bool drawsSameAs(const OpenGLMaterialInstance& other) const;
+
 private:
+	// where each property stands on the game thread
+	enum class ValueState : uint8
+	{
+		UNSET,
+		CLEAN, // the render thread has it
+		DIRTY  // it goes out with the next takePropertyUpdates
+	};
+
+	// set from a pointer, so it is read again every snapshot
+	struct WatchedProperty
+	{
+		uint32 ID;
+		MaterialPropertyType type;
+		const void* value;
+	};
+
+	struct UniformValue
+	{
+		GLint location;
+		MaterialPropertyType type;
+		OpenGLPropertyValue value;
+	};
+
+	/// <summary> Gets the ID for propName, for the name based setters. </summary>
+	uint32 getPropertyID(const std::string& propName, MaterialPropertyType type);
+
+	void watchProperty(const std::string& propName, MaterialPropertyType type, const void* value);
+
+	/// <summary> Copies value into the parameter block the way the shader lays it out. </summary>
+	void writeParameter(
+		const OpenGLMaterialSource::PropertyBinding& binding, const OpenGLPropertyValue& value);
+
+	void setUniform(OpenGLStateCache& state, const UniformValue& uniform);
+
+	void updateBatchSignature();
+
 	OpenGLRenderer& renderer;
 
-	const static uint32 maxTextures = 32;
+	const static uint32 maxTextures = OpenGLTextureBindings::maxTextures;
 
 	std::function<void(MaterialInstance&)> updateCallback;
+	uint64 lastUpdatedFrame; // the frame the callback last ran in
 
 	OpenGLMaterialSource* program;
 
-	std::unordered_map<std::string, std::function<void()>> properties;
-
-	// vector of <texture ID>
-	std::array<OpenGLTexture*, maxTextures> textures;
-	std::array<std::shared_ptr<OpenGLTexture>, maxTextures> refCountedTextures; // TODO: think about this
-};
\ No newline at end of file
+	// game thread, by property ID
+	std::vector<OpenGLPropertyValue> values;
+	std::vector<ValueState> valueStates;
+	std::vector<uint32> dirtyIDs;
+	std::vector<WatchedProperty> watchedProperties;
+
+	/// <summary> Finds where the render thread keeps a texture's GL name and what it binds to. Textures and
+	/// texture libraries both come through setTexture. </summary>
+	static OpenGLTextureState* getState(Texture* texture, GLenum& target);
+
+	// game thread -- what setTexture was given, which goes out with the next takeTextureBindings
+	OpenGLTextureBindings textures;
+	bool bisTexturesDirty;
+	std::array<std::shared_ptr<Texture>, maxTextures> refCountedTextures; // just keeps them alive
+
+	// render thread, by property ID -- what the game thread has sent so far
+	std::vector<OpenGLPropertyValue> renderValues;
+	std::vector<uint8> renderValueSet;
+	OpenGLTextureBindings renderTextures; // where to read each unit's GL name from at draw time
+	bool bisLayoutDirty;
+
+	// render thread, laid out for the shader
+	std::vector<uint8> parameterBlock;
+	GLuint parameterBuffer;
+	std::vector<UniformValue> uniformValues;
+	std::array<uint32, OpenGLMaterialSource::maxInstanceProperties> instanceProperties;
+
+	size_t batchSignature;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <MaterialSource.h>
+
+#include <array>
+
+// One material property's value, as raw bytes. Big enough for a mat4.
+struct OpenGLPropertyValue
+{
+	std::array<uint8, sizeof(float) * 16> bytes;
+};
+
+// A property that changed on the game thread, on its way to the render thread in a draw packet.
+struct OpenGLPropertyUpdate
+{
+	uint32 ID;
+	OpenGLPropertyValue value;
+};
+
+struct OpenGLTextureState;
+
+// Which texture each unit of a material reads, on its way to the render thread in a draw packet when it
+// changed. Units are filled from 0, and the first nullptr ends the list.
+struct OpenGLTextureBindings
+{
+	static const uint32 maxTextures = 32;
+
+	std::array<OpenGLTextureState*, maxTextures> states;
+	std::array<GLenum, maxTextures> targets; // GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for libraries
+};
+
+/// <summary> How many bytes a value of type takes, tightly packed. </summary>
+inline size_t getPropertySize(MaterialPropertyType type)
+{
+	switch (type)
+	{
+	case MaterialPropertyType::INT: return sizeof(int32);
+	case MaterialPropertyType::IVEC2: return sizeof(ivec2);
+	case MaterialPropertyType::IVEC3: return sizeof(ivec3);
+	case MaterialPropertyType::IVEC4: return sizeof(ivec4);
+	case MaterialPropertyType::FLOAT: return sizeof(float);
+	case MaterialPropertyType::VEC2: return sizeof(vec2);
+	case MaterialPropertyType::VEC3: return sizeof(vec3);
+	case MaterialPropertyType::VEC4: return sizeof(vec4);
+	case MaterialPropertyType::MAT2: return sizeof(mat2);
+	case MaterialPropertyType::MAT3: return sizeof(mat3);
+	case MaterialPropertyType::MAT4: return sizeof(mat4);
+	default: return 0;
+	}
+}
+
+/// <summary> What glGetActiveUniformsiv and glGetActiveAttrib call type. </summary>
+inline GLenum getPropertyGLType(MaterialPropertyType type)
+{
+	switch (type)
+	{
+	case MaterialPropertyType::INT: return GL_INT;
+	case MaterialPropertyType::IVEC2: return GL_INT_VEC2;
+	case MaterialPropertyType::IVEC3: return GL_INT_VEC3;
+	case MaterialPropertyType::IVEC4: return GL_INT_VEC4;
+	case MaterialPropertyType::FLOAT: return GL_FLOAT;
+	case MaterialPropertyType::VEC2: return GL_FLOAT_VEC2;
+	case MaterialPropertyType::VEC3: return GL_FLOAT_VEC3;
+	case MaterialPropertyType::VEC4: return GL_FLOAT_VEC4;
+	case MaterialPropertyType::MAT2: return GL_FLOAT_MAT2;
+	case MaterialPropertyType::MAT3: return GL_FLOAT_MAT3;
+	case MaterialPropertyType::MAT4: return GL_FLOAT_MAT4;
+	default: return 0;
+	}
+}
+
+/// <summary> The number of columns a matrix type has, or 0 if it isn't one. </summary>
+inline uint32 getPropertyColumns(MaterialPropertyType type)
+{
+	switch (type)
+	{
+	case MaterialPropertyType::MAT2: return 2;
+	case MaterialPropertyType::MAT3: return 3;
+	case MaterialPropertyType::MAT4: return 4;
+	default: return 0;
+	}
+}
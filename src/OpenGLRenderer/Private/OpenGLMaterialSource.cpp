@@ -7,11 +7,22 @@
 #include "Helper.h"
 
 #include <thread>
+#include <vector>
 
 OpenGLMaterialSource::OpenGLMaterialSource(OpenGLRenderer& renderer, const path_t& name)
-	: renderer(renderer)
+	: startTexUniform(-1)
+	, startTexArrayUniform(-1)
+	, renderOrderUniformLocation(-1)
 	, name(name)
+	, renderer(renderer)
+	, program(0)
+	, bisResident(false)
+	, bisOpaque(false)
+	, parameterBlockIndex(GL_INVALID_INDEX)
+	, parameterBlockSize(0)
 {
+	instancePropertyTypes.fill(0);
+
 	if (!name.empty()) init(name);
 }
 
@@ -24,19 +35,31 @@ OpenGLMaterialSource& OpenGLMaterialSource::operator=(OpenGLMaterialSource&& oth
 
 	this->program = other.program;
 	this->name = other.name;
-	this->MVPUniformLocation = other.MVPUniformLocation;
 	this->startTexUniform = other.startTexUniform;
+	this->startTexArrayUniform = other.startTexArrayUniform;
+	this->renderOrderUniformLocation = other.renderOrderUniformLocation;
+	this->bisResident = other.bisResident;
+	this->bisOpaque = other.bisOpaque;
+	this->instancePropertyTypes = other.instancePropertyTypes;
+	this->instancePropertyNames = other.instancePropertyNames;
+	this->propertyBindings = other.propertyBindings;
+	this->parameterBlockIndex = other.parameterBlockIndex;
+	this->parameterBlockSize = other.parameterBlockSize;
+
+	{
+		std::lock_guard<std::mutex> lock{other.propertyMutex};
+		this->propertyIDs = other.propertyIDs;
+		this->properties = other.properties;
+	}
 
 	return *this;
 }
 
 OpenGLMaterialSource::~OpenGLMaterialSource()
 {
-
-	renderer.runOnRenderThreadSync([this]
-		{
-			glDeleteProgram(program);
-		});
+	// sources live in the renderer's cache, so this only runs after the renderer has synced with the render
+	// thread and the name is safe to read here
+	renderer.retireGLObject(OpenGLObjectType::PROGRAM, program);
 }
 
 void OpenGLMaterialSource::init(const path_t& name)
@@ -48,92 +71,322 @@ void OpenGLMaterialSource::init(const path_t& name)
 	assert(boost::filesystem::exists(vertexPath));
 	assert(boost::filesystem::exists(fragPath));
 
-	renderer.runOnRenderThreadSync([this, &vertexPath, &fragPath, &name]
-		{
-
-			// Create the shaders
-			GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-			GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	// read the files here so the render thread only has to compile, or not even that if there's a binary
+	std::string VertexShaderCode = loadFileToStr(vertexPath);
+	std::string FragmentShaderCode = loadFileToStr(fragPath);
 
-			// Read the Vertex Shader code from the file
-			std::string&& VertexShaderCode = loadFileToStr(vertexPath);
+	// drivers ignore pragmas they don't know, so this can sit in the source
+	bisOpaque = FragmentShaderCode.find("#pragma opaque") != std::string::npos;
 
-			// Read the Fragment Shader code from the file
-			std::string&& FragmentShaderCode = loadFileToStr(fragPath);
+	auto&& programCache = renderer.getProgramCache();
+	uint64 sourceHash = OpenGLProgramCache::hashSources(VertexShaderCode, FragmentShaderCode);
+	std::vector<char> cachedBinary = programCache.readBinaryFile(name);
 
-			int32 Result = GL_FALSE;
-			int InfoLogLength;
+	renderer.runOnRenderThreadDetached([
+		this,
+		&programCache,
+		vertexPath,
+		fragPath,
+		name,
+		sourceHash,
+		cachedBinary = std::move(cachedBinary),
+		VertexShaderCode = std::move(VertexShaderCode),
+		FragmentShaderCode = std::move(FragmentShaderCode)
+	]
+		{
+			program = programCache.loadProgram(name, sourceHash, cachedBinary);
+			if (program == 0) {
+				auto compileStart = std::chrono::steady_clock::now();
 
-			// Compile Vertex Shader
-			MFLOG(Trace) << "Compiling vertex Shader " << vertexPath;
+				program = compileProgram(vertexPath, fragPath, VertexShaderCode, FragmentShaderCode);
 
-			const char* VertexSourcePointer = VertexShaderCode.c_str();
-			glShaderSource(vertexShader, 1, &VertexSourcePointer, nullptr);
-			glCompileShader(vertexShader);
+				// it stays non-resident, so nothing draws with it
+				if (program == 0) return;
 
-			// Check Vertex Shader
-			glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &Result);
-			glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
-			if (InfoLogLength > 1) {
-				auto VertexShaderErrorMessage = std::vector<char>(InfoLogLength + 1);
-				glGetShaderInfoLog(vertexShader, InfoLogLength, nullptr, VertexShaderErrorMessage.data());
-				MFLOG(Error) << VertexShaderErrorMessage.data();
-			}
-			else
-			{
-				MFLOG(Trace) << "\tShader " << vertexPath << " Successfully Compiled";
+				programCache.storeProgram(name,
+					sourceHash,
+					program,
+					std::chrono::duration_cast<std::chrono::microseconds>(
+						std::chrono::steady_clock::now() - compileStart));
 			}
 
-			// Compile Fragment Shader
-			MFLOG(Trace) << "\tCompiling fragment Shader " << fragPath;
-			const char* FragmentSourcePointer = FragmentShaderCode.c_str();
-			glShaderSource(fragmentShader, 1, &FragmentSourcePointer, nullptr);
-			glCompileShader(fragmentShader);
-
-			// Check Fragment Shader
-			glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &Result);
-			glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
-			if (InfoLogLength > 1) {
-				auto FragmentShaderErrorMessage = std::vector<char>(InfoLogLength + 1);
-				glGetShaderInfoLog(fragmentShader, InfoLogLength, nullptr, FragmentShaderErrorMessage.data());
-				MFLOG(Error) << FragmentShaderErrorMessage.data();
-			}
-			else
-			{
-				MFLOG(Trace) << "\tShader " << fragPath << " Successfully Compiled";
+			startTexUniform = glGetUniformLocation(program, "textures");
+			startTexArrayUniform = glGetUniformLocation(program, "textureArrays");
+			if (startTexUniform == -1 && startTexArrayUniform == -1) {
+				MFLOG(Warning) << "Could not find startTexUniform in program: " << name;
 			}
+			if (startTexUniform != -1 && startTexArrayUniform != -1) parkSamplers();
+
+			renderOrderUniformLocation = glGetUniformLocation(program, "renderOrder");
+
+			// anything else the vertex shader takes per instance is a property that gets batched
+			GLint numAttributes = 0;
+			glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &numAttributes);
+			for (GLint i = 0; i < numAttributes; ++i) {
+				char attribName[256];
+				GLint size;
+				GLenum type;
+				glGetActiveAttrib(program, i, sizeof(attribName), nullptr, &size, &type, attribName);
+
+				GLint location = glGetAttribLocation(program, attribName);
+				if (location < (GLint)firstInstancePropertyLocation
+					|| location >= (GLint)(firstInstancePropertyLocation + maxInstanceProperties))
+					continue;
 
-			// Link the program
-			MFLOG(Trace) << "\tLinking program " << name;
-			program = glCreateProgram();
-			glAttachShader(program, vertexShader);
-			glAttachShader(program, fragmentShader);
-			glLinkProgram(program);
-
-			// Check the program
-			glGetProgramiv(program, GL_LINK_STATUS, &Result);
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &InfoLogLength);
-			if (InfoLogLength > 1) {
-				auto ProgramErrorMessage = std::vector<char>(InfoLogLength + 1);
-				glGetProgramInfoLog(program, InfoLogLength, nullptr, ProgramErrorMessage.data());
-				MFLOG(Error) << ProgramErrorMessage.data();
+				if (type != GL_INT && type != GL_FLOAT) {
+					MFLOG(Warning) << "Instance property " << attribName << " in program " << name
+								   << " must be a single int or float";
+					continue;
+				}
+
+				instancePropertyTypes[location - firstInstancePropertyLocation] = type;
+				instancePropertyNames[location - firstInstancePropertyLocation] = attribName;
 			}
 
-			glDeleteShader(vertexShader);
-			glDeleteShader(fragmentShader);
+			// the per-material uniform block, if it has one. They all go on the same binding point.
+			parameterBlockIndex = glGetUniformBlockIndex(program, "MaterialParams");
+			if (parameterBlockIndex != GL_INVALID_INDEX) {
+				GLint blockSize = 0;
+				glGetActiveUniformBlockiv(
+					program, parameterBlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+				parameterBlockSize = blockSize;
 
-			startTexUniform = glGetUniformLocation(program, "textures");
-			if (startTexUniform == -1) {
-				MFLOG(Warning) << "Could not find startTexUniform in program: " << name;
+				glUniformBlockBinding(program, parameterBlockIndex, parameterBlockBinding);
 			}
 
-			MVPUniformLocation = glGetUniformLocation(program, "MVPmat");
-			if (MVPUniformLocation == -1) {
-				MFLOG(Warning) << "Could not find MVPUniformLocation in program: " << name;
+			// the view is in a block every world space program shares, so nothing sets it per draw. Screen
+			// space ones, like text, don't have it.
+			GLuint cameraBlockIndex = glGetUniformBlockIndex(program, "Camera");
+			if (cameraBlockIndex != GL_INVALID_INDEX) {
+				glUniformBlockBinding(program, cameraBlockIndex, cameraBlockBinding);
 			}
 
+			// anything asked for before now
+			resolvePropertyBindings();
+
 			MFLOG(Trace) << "\tSuccessfully Linked Program: " << name;
+
+			bisResident = true;
 		});
 }
 
+GLuint OpenGLMaterialSource::compileProgram(const path_t& vertexPath,
+	const path_t& fragPath,
+	const std::string& VertexShaderCode,
+	const std::string& FragmentShaderCode)
+{
+	// this runs on the render thread, where an Error log would throw with nothing to catch it -- so failures
+	// are warnings, and the source just never becomes resident
+	auto compileShader = [](GLenum type, const path_t& path, const std::string& code) -> GLuint
+	{
+		MFLOG(Trace) << "\tCompiling shader " << path;
+
+		GLuint shader = glCreateShader(type);
+		const char* SourcePointer = code.c_str();
+		glShaderSource(shader, 1, &SourcePointer, nullptr);
+		glCompileShader(shader);
+
+		int32 Result = GL_FALSE;
+		int InfoLogLength = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &Result);
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &InfoLogLength);
+
+		auto InfoLog = std::vector<char>(std::max(InfoLogLength, 1) + 1);
+		if (InfoLogLength > 1) glGetShaderInfoLog(shader, InfoLogLength, nullptr, InfoLog.data());
+
+		if (Result != GL_TRUE) {
+			MFLOG(Warning) << "Shader " << path << " failed to compile: " << InfoLog.data();
+			glDeleteShader(shader);
+			return 0;
+		}
+
+		// drivers can have something to say about shaders that compiled fine
+		if (InfoLogLength > 1) {
+			MFLOG(Trace) << "\tShader " << path << " compiled with: " << InfoLog.data();
+		}
+		else
+		{
+			MFLOG(Trace) << "\tShader " << path << " Successfully Compiled";
+		}
+
+		return shader;
+	};
+
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexPath, VertexShaderCode);
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragPath, FragmentShaderCode);
+	if (vertexShader == 0 || fragmentShader == 0) {
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	// Link the program
+	MFLOG(Trace) << "\tLinking program " << name;
+	GLuint newProgram = glCreateProgram();
+	glAttachShader(newProgram, vertexShader);
+	glAttachShader(newProgram, fragmentShader);
+	renderer.getProgramCache().prepareProgram(newProgram);
+	glLinkProgram(newProgram);
+
+	// the program keeps what it needs, so the shaders can go either way
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	// Check the program
+	int32 Result = GL_FALSE;
+	int InfoLogLength = 0;
+	glGetProgramiv(newProgram, GL_LINK_STATUS, &Result);
+	glGetProgramiv(newProgram, GL_INFO_LOG_LENGTH, &InfoLogLength);
+
+	auto ProgramInfoLog = std::vector<char>(std::max(InfoLogLength, 1) + 1);
+	if (InfoLogLength > 1) glGetProgramInfoLog(newProgram, InfoLogLength, nullptr, ProgramInfoLog.data());
+
+	if (Result != GL_TRUE) {
+		MFLOG(Warning) << "Program " << name << " failed to link: " << ProgramInfoLog.data();
+		glDeleteProgram(newProgram);
+		return 0;
+	}
+
+	if (InfoLogLength > 1) MFLOG(Trace) << "\tProgram " << name << " linked with: " << ProgramInfoLog.data();
+
+	return newProgram;
+}
+
 path_t OpenGLMaterialSource::getName() const { return name; }
+
+void OpenGLMaterialSource::parkSamplers()
+{
+	// past the units materials use, and GL 3.3 has at least 48
+	const GLint parkedTextureUnit = OpenGLStateCache::maxTextureUnits;
+	const GLint parkedTextureArrayUnit = OpenGLStateCache::maxTextureUnits + 1;
+
+	renderer.getStateCache().useProgram(program);
+
+	GLint numUniforms = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+	for (GLint i = 0; i < numUniforms; ++i) {
+		char uniformName[256];
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program, i, sizeof(uniformName), nullptr, &size, &type, uniformName);
+
+		if (type != GL_SAMPLER_2D && type != GL_SAMPLER_2D_ARRAY) continue;
+
+		GLint parkedUnit = type == GL_SAMPLER_2D ? parkedTextureUnit : parkedTextureArrayUnit;
+		auto units = std::vector<GLint>(size, parkedUnit);
+		glUniform1iv(glGetUniformLocation(program, uniformName), size, units.data());
+	}
+}
+
+int32 OpenGLMaterialSource::getInstancePropertySlot(const std::string& propName) const
+{
+	for (uint32 i = 0; i < maxInstanceProperties; ++i) {
+		if (instancePropertyTypes[i] != 0 && instancePropertyNames[i] == propName) return i;
+	}
+
+	return -1;
+}
+
+uint32 OpenGLMaterialSource::getPropertyID(const std::string& propName, MaterialPropertyType type)
+{
+	std::lock_guard<std::mutex> lock{propertyMutex};
+
+	auto iter = propertyIDs.find(propName);
+	if (iter != propertyIDs.end()) {
+		if (properties[iter->second].second != type) {
+			MFLOG(Warning) << "Material property " << propName << " in program " << name
+						   << " was already asked for as another type";
+			return invalidMaterialPropertyID;
+		}
+
+		return iter->second;
+	}
+
+	auto ID = static_cast<uint32>(properties.size());
+	properties.emplace_back(propName, type);
+	propertyIDs.emplace(propName, ID);
+
+	return ID;
+}
+
+const OpenGLMaterialSource::PropertyBinding& OpenGLMaterialSource::getPropertyBinding(uint32 ID)
+{
+	assert(bisResident);
+
+	if (ID >= propertyBindings.size()) resolvePropertyBindings();
+
+	assert(ID < propertyBindings.size());
+	return propertyBindings[ID];
+}
+
+void OpenGLMaterialSource::resolvePropertyBindings()
+{
+	std::lock_guard<std::mutex> lock{propertyMutex};
+
+	for (size_t ID = propertyBindings.size(); ID < properties.size(); ++ID) {
+		propertyBindings.push_back(resolvePropertyBinding(properties[ID].first, properties[ID].second));
+	}
+}
+
+OpenGLMaterialSource::PropertyBinding OpenGLMaterialSource::resolvePropertyBinding(
+	const std::string& propName, MaterialPropertyType type) const
+{
+	PropertyBinding ret{};
+	ret.kind = PropertyBinding::Kind::MISSING;
+	ret.type = type;
+	ret.location = -1;
+
+	int32 slot = getInstancePropertySlot(propName);
+	if (slot != -1) {
+		if (instancePropertyTypes[slot] != getPropertyGLType(type)) {
+			MFLOG(Warning) << "Instance property " << propName << " in program " << name
+						   << " is set as the wrong type";
+			return ret;
+		}
+
+		ret.kind = PropertyBinding::Kind::INSTANCE;
+		ret.slot = slot;
+		return ret;
+	}
+
+	const char* uniformName = propName.c_str();
+	GLuint index = GL_INVALID_INDEX;
+	glGetUniformIndices(program, 1, &uniformName, &index);
+	if (index == GL_INVALID_INDEX) {
+		MFLOG(Warning) << "Could not find material property " << propName << " in program: " << name;
+		return ret;
+	}
+
+	GLint uniformType;
+	GLint blockIndex;
+	GLint offset;
+	GLint matrixStride;
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_TYPE, &uniformType);
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &offset);
+	glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &matrixStride);
+
+	if ((GLenum)uniformType != getPropertyGLType(type)) {
+		MFLOG(Warning) << "Material property " << propName << " in program " << name
+					   << " is set as the wrong type";
+		return ret;
+	}
+
+	if (blockIndex == -1) {
+		ret.kind = PropertyBinding::Kind::UNIFORM;
+		ret.location = glGetUniformLocation(program, uniformName);
+	}
+	else if ((GLuint)blockIndex == parameterBlockIndex)
+	{
+		ret.kind = PropertyBinding::Kind::PARAMETER_BLOCK;
+		ret.offset = offset;
+		ret.matrixStride = matrixStride;
+	}
+	else
+	{
+		MFLOG(Warning) << "Material property " << propName << " in program " << name
+					   << " is in a uniform block other than MaterialParams";
+	}
+
+	return ret;
+}
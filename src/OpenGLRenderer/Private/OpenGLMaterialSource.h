@@ -2,9 +2,17 @@
 
 #include "OpenGLRendererConfig.h"
 
+#include "OpenGLMaterialProperty.h"
+
 #include <MaterialSource.h>
 #include <Cacher.h>
 
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class OpenGLRenderer;
 
 class OpenGLMaterialSource : public MaterialSource
@@ -28,13 +36,112 @@ public:
 
 	virtual path_t getName() const override;
 
+	/// <summary> Safe from any thread. invalidMaterialPropertyID, with a warning, if name was already asked for
+	/// as another type. </summary>
+	virtual uint32 getPropertyID(const std::string& name, MaterialPropertyType type) override;
+
 	GLint operator*() const { return program; }
 
+	// where a property's value goes, worked out once the program is linked
+	struct PropertyBinding
+	{
+		enum class Kind : uint8
+		{
+			MISSING,		 // the shader doesn't have it, or has it as something else
+			PARAMETER_BLOCK, // a member of the MaterialParams uniform block
+			INSTANCE,		 // a per-instance vertex attribute
+			UNIFORM			 // a plain uniform
+		};
+
+		Kind kind;
+		MaterialPropertyType type;
+
+		uint32 offset;		 // PARAMETER_BLOCK: bytes into the block
+		uint32 matrixStride; // PARAMETER_BLOCK: bytes between matrix columns
+		uint32 slot;		 // INSTANCE: index into OpenGLInstanceData::properties
+		GLint location;		 // UNIFORM
+	};
+
+	/// <summary> Gets where the property with ID goes. Properties asked for after linking are worked out
+	/// the first time they get here. Render thread only, once isResident. </summary>
+	const PropertyBinding& getPropertyBinding(uint32 ID);
+
+	/// <summary> How big the MaterialParams block is, or 0 if the shader doesn't have one. Render thread
+	/// only. </summary>
+	uint32 getParameterBlockSize() const { return parameterBlockSize; }
+
+	/// <summary> If the program has been linked yet. Render thread only. </summary>
+	bool isResident() const { return bisResident; }
+
+	/// <summary> If the fragment shader has #pragma opaque -- it writes every pixel it keeps at full alpha,
+	/// so it can be drawn front to back with depth writes instead of blended. </summary>
+	bool isOpaque() const { return bisOpaque; }
+
+	/// <summary> Finds the per-instance property a vertex attribute was declared for. Render thread only.
+	/// </summary>
+	///
+	/// <returns> The slot in OpenGLInstanceData::properties, or -1 if it isn't one. </returns>
+	int32 getInstancePropertySlot(const std::string& propName) const;
+
+	/// <summary> If the property in slot is an int in the shader, rather than a float. </summary>
+	bool isInstancePropertyInteger(uint32 slot) const { return instancePropertyTypes[slot] == GL_INT; }
+
+	/// <summary> If the shader reads the property in slot at all. </summary>
+	bool hasInstanceProperty(uint32 slot) const { return instancePropertyTypes[slot] != 0; }
+
+	// model shaders take their per-instance data as vertex attributes at these locations
+	static const GLuint instanceModelMatLocation = 2; // a mat3, so it takes 2 through 4
+	static const GLuint firstInstancePropertyLocation = 5;
+	static const uint32 maxInstanceProperties = 4;
+
+	// every program's MaterialParams block is bound here, so a material only has to bind its buffer
+	static const GLuint parameterBlockBinding = 0;
+
+	// and every program's Camera block here. The renderer fills it once a frame and leaves it bound.
+	static const GLuint cameraBlockBinding = 1;
+
+	// texture slot i is textures[i] in the shader, or textureArrays[i] if it holds a texture array
 	int32 startTexUniform;
-	int32 MVPUniformLocation;
+	int32 startTexArrayUniform;
+	int32 renderOrderUniformLocation;
 
 private:
 	path_t name;
 	OpenGLRenderer& renderer;
 	GLint program;
+	bool bisResident;
+	bool bisOpaque;
+
+	// GL_INT or GL_FLOAT, or 0 if the shader doesn't have that slot
+	std::array<GLenum, maxInstanceProperties> instancePropertyTypes;
+	std::array<std::string, maxInstanceProperties> instancePropertyNames;
+
+	/// <summary> Compiles and links the shaders into a new program, logging anything that goes wrong as a
+	/// warning. Render thread only. </summary>
+	///
+	/// <returns> The program, or 0 if a shader didn't compile or it didn't link. </returns>
+	GLuint compileProgram(const path_t& vertexPath,
+		const path_t& fragPath,
+		const std::string& VertexShaderCode,
+		const std::string& FragmentShaderCode);
+
+	/// <summary> Points every 2D and array sampler at a unit of its own that nothing binds, until a material
+	/// sets them. Left at 0, a textures[i] the shader doesn't read would clash with a textureArrays[i] it
+	/// does. Render thread only, right after linking. </summary>
+	void parkSamplers();
+
+	/// <summary> Works out the bindings for every property that has been asked for since the last call.
+	/// </summary>
+	void resolvePropertyBindings();
+	PropertyBinding resolvePropertyBinding(const std::string& propName, MaterialPropertyType type) const;
+
+	// every property that has been asked for, by ID -- any thread, under propertyMutex
+	std::mutex propertyMutex;
+	std::unordered_map<std::string, uint32> propertyIDs;
+	std::vector<std::pair<std::string, MaterialPropertyType>> properties;
+
+	// render thread, by ID
+	std::vector<PropertyBinding> propertyBindings;
+	GLuint parameterBlockIndex;
+	uint32 parameterBlockSize;
 };
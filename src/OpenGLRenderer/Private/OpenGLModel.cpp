@@ -18,7 +18,10 @@
 OpenGLModel::OpenGLModel(OpenGLRenderer& renderer, uint8 renderOrder)
 	: renderer(renderer)
 	, renderOrder(renderOrder)
-	, isValid(true)
+	, bisStatic(false)
+	, bisInGrid(false)
+	, parent(nullptr)
+	, slot(0)
 {
 }
 
@@ -27,9 +30,16 @@ OpenGLModel::~OpenGLModel() = default;
 void OpenGLModel::init(
 	std::shared_ptr<MaterialInstance> mat, std::shared_ptr<ModelData> data, MeshComponent& ownerComp)
 {
+	// packets in frames already submitted still point at the old ones
+	if (material != mat) renderer.retireFrameResource(std::move(material));
+	if (modelData != data) renderer.retireFrameResource(std::move(modelData));
+
 	material = std::static_pointer_cast<OpenGLMaterialInstance>(mat);
 	modelData = std::static_pointer_cast<OpenGLModelData>(data);
 	parent = &ownerComp;
+
+	// the bounds it was put in the grid with could be different now
+	if (bisInGrid) renderer.removeModelFromGrid(*this);
 }
 
 MeshComponent& OpenGLModel::getOwnerComponent()
@@ -46,28 +56,45 @@ const MeshComponent& OpenGLModel::getOwnerComponent() const
 
 uint8 OpenGLModel::getRenderOrder() const { return renderOrder; }
 
-void OpenGLModel::draw()
+void OpenGLModel::setStatic(bool bisNowStatic)
 {
-	if (!isValid) return;
-	isValid = false; // set this so it doesn't get destructed while this is happening.
+	assert(parent);
 
-	assert(renderer.isOnRenderThread());
+	bisStatic = bisNowStatic;
+	if (bisStatic) staticModelMat = parent->getModelMatrix();
 
-	mat3 view = renderer.getCurrentCamera().getViewMat();
-	mat3 model = parent->getModelMatrix();
+	// the renderer puts static models back in once it knows their bounds
+	if (bisInGrid) renderer.removeModelFromGrid(*this);
+}
 
-	mat3 MVPmat = view * model;
+mat3 OpenGLModel::getModelMatrix() const
+{
+	assert(parent);
 
-	auto&& matSource = static_cast<OpenGLMaterialSource*>(material->getSource());
+	return bisStatic ? staticModelMat : parent->getModelMatrix();
+}
 
-	assert(material);
-	material->use();
+bool OpenGLModel::getWorldBounds(const mat3& modelMat, OpenGLBounds& bounds) const
+{
+	OpenGLBounds localBounds;
+	if (!modelData || !modelData->getLocalBounds(localBounds)) return false;
 
-	glUniformMatrix3fv(matSource->MVPUniformLocation, 1, GL_FALSE, &MVPmat[0][0]);
+	bounds = OpenGLBounds::transformed(modelMat, localBounds.min, localBounds.max);
+	return true;
+}
+
+bool OpenGLModel::snapshot(const mat3& modelMat, OpenGLDrawPacket& packet) const
+{
+	assert(!renderer.isOnRenderThread());
 
-	glUniform1f(glGetUniformLocation(**matSource, "renderOrder"), 1.f);
+	if (!parent || !material || !modelData) return false;
 
-	modelData->draw();
+	packet.modelMat = modelMat;
+	packet.material = material.get();
+	packet.modelData = modelData.get();
+	packet.renderOrder = renderOrder;
+	packet.propertyUpdates = material->takePropertyUpdates(packet.numPropertyUpdates);
+	packet.textureBindings = material->takeTextureBindings();
 
-	isValid = true; // ok -- were done -- you can destruct me now.
+	return true;
 }
@@ -4,12 +4,28 @@
 #include <ModelData.h>
 #include <Model.h>
 
-#include <atomic>
-
+#include "OpenGLCullingGrid.h"
 #include "OpenGLMaterialInstance.h"
 
 class OpenGLModelData;
 
+// Everything the render thread needs to draw one model. These are copied on the game thread at the end of a
+// tick, so the render thread never reads a live transform. OpenGLBatcher draws them. The material and model
+// data aren't owned -- the renderer keeps them alive until the frame is done, through the model or, once the
+// model lets go of them, its retired resources.
+struct OpenGLDrawPacket
+{
+	mat3 modelMat; // the view is in the Camera block
+	OpenGLMaterialInstance* material;
+	OpenGLModelData* modelData;
+	uint8 renderOrder;
+
+	// what changed in the material since it was last snapshotted
+	const OpenGLPropertyUpdate* propertyUpdates;
+	uint32 numPropertyUpdates;
+	const OpenGLTextureBindings* textureBindings; // nullptr if they didn't change
+};
+
 class OpenGLModel final : public Model
 {
 public:
@@ -27,19 +43,39 @@ public:
 
 	virtual uint8 getRenderOrder() const override;
 
-	void draw();
+	virtual void setStatic(bool bisStatic) override;
+
+	bool isStatic() const { return bisStatic; }
+
+	/// <summary> Gets where the model is -- the one from setStatic if it is static. Game thread only, once
+	/// it has an owner. </summary>
+	mat3 getModelMatrix() const;
+
+	/// <summary> Works out the model's bounds in world space. Game thread only. </summary>
+	///
+	/// <returns> false if the model data doesn't have any vertices yet. </returns>
+	bool getWorldBounds(const mat3& modelMat, OpenGLBounds& bounds) const;
+
+	/// <summary> Copies what is needed to draw this model into packet, and takes the material's property
+	/// updates since the last snapshot. The material's update callback runs in the first snapshot of it each
+	/// frame. Game thread only. </summary>
+	///
+	/// <returns> false if there is nothing to draw yet. </returns>
+	bool snapshot(const mat3& modelMat, OpenGLDrawPacket& packet) const;
 
 private:
 	uint8 renderOrder;
 
-	std::atomic<bool> isValid;
+	bool bisStatic;
+	bool bisInGrid; // in OpenGLRenderer::cullingGrid, rather than a slot in OpenGLRenderer::models
+	mat3 staticModelMat;
 
 	std::shared_ptr<OpenGLModelData> modelData;
 	std::shared_ptr<OpenGLMaterialInstance> material;
 
 	MeshComponent* parent;
 
-	std::list<OpenGLModel*>::iterator location;
+	uint32 slot; // where it is in OpenGLRenderer::models, unless it's in the grid
 
 	OpenGLRenderer& renderer;
 };
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include <Helper.h>
 
+#include <vector>
+
 void OpenGLModelData::init(
 	const vec2* vertLocs_, const vec2* UVs_, size_t numVerts_, const uvec3* elems_, size_t numElems_)
 {
@@ -16,28 +18,71 @@ void OpenGLModelData::init(
 	assert(numVerts);
 	assert(numElems);
 
-	renderer.runOnRenderThreadSync([this, vertLocs_, UVs_, elems_]
+	localBounds = OpenGLBounds{vertLocs_[0], vertLocs_[0]};
+	for (size_t i = 1; i < numVerts; ++i) {
+		localBounds.min = glm::min(localBounds.min, vertLocs_[i]);
+		localBounds.max = glm::max(localBounds.max, vertLocs_[i]);
+	}
+
+	// copy it so the caller doesn't have to wait for the upload
+	std::vector<vec2> vertLocs(vertLocs_, vertLocs_ + numVerts);
+	std::vector<vec2> UVs(UVs_, UVs_ + numVerts);
+	std::vector<uvec3> elems(elems_, elems_ + numElems);
+
+	auto&& renderer = this->renderer;
+	auto buffers = this->buffers;
+
+	renderer.runOnRenderThreadDetached([
+		&renderer,
+		buffers,
+		vertLocs = std::move(vertLocs),
+		UVs = std::move(UVs),
+		elems = std::move(elems)
+	]
 		{
 
-			// init GL buffers
-			glGenVertexArrays(1, &vertexArray);
-			glBindVertexArray(vertexArray);
+			// init GL buffers. Everything set up from here on is kept in the VAO, so drawing only has to
+			// bind that.
+			glGenVertexArrays(1, &buffers->vertexArray);
+			renderer.getStateCache().bindVertexArray(buffers->vertexArray);
 
 			// init location buffer
-			glGenBuffers(1, &vertexLocationBuffer);
-			glBindBuffer(GL_ARRAY_BUFFER, vertexLocationBuffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * numVerts, vertLocs_, GL_STATIC_DRAW);
+			glGenBuffers(1, &buffers->vertexLocationBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffers->vertexLocationBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * vertLocs.size(), vertLocs.data(), GL_STATIC_DRAW);
+
+			// bind location data to the element attrib array so it shows up in our shaders -- the location is
+			// zero (look in shader)
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, // location 0 (see shader)
+				2,					 // two elements per vertex (x,y)
+				GL_FLOAT,			 // they are floats
+				GL_FALSE,			 // not normalized
+				sizeof(float) * 2,   // the next element is 2 floats later
+				nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
+				);
 
 			// init UV buffer
-			glGenBuffers(1, &texCoordBuffer);
-			glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * numVerts, UVs_, GL_STATIC_DRAW);
-
-			// init elem buffer
-			glGenBuffers(1, &elemBuffer);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elemBuffer);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uvec3) * numElems, elems_, GL_STATIC_DRAW);
-
+			glGenBuffers(1, &buffers->texCoordBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffers->texCoordBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * UVs.size(), UVs.data(), GL_STATIC_DRAW);
+
+			// same for the UVs, at location 1
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, // location 1 (see shader)
+				2,					 // two elements per vertex (u,v)
+				GL_FLOAT,			 // they are floats
+				GL_FALSE,			 // not normalized
+				sizeof(float) * 2,   // the next element is 2 floats later
+				nullptr				 // use the GL_ARRAY_BUFFER instead of copying on the spot
+				);
+
+			// init elem buffer -- the VAO keeps this binding too
+			glGenBuffers(1, &buffers->elemBuffer);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->elemBuffer);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uvec3) * elems.size(), elems.data(), GL_STATIC_DRAW);
+
+			buffers->bisResident = true;
 		});
 
 	bisInitialized = true;
@@ -47,13 +92,19 @@ bool OpenGLModelData::isInitialized() { return bisInitialized; }
 
 OpenGLModelData::~OpenGLModelData()
 {
+	// doesn't wait -- the names go to the deletion queue once the render thread gets here, which is after
+	// init's upload, and the GPU lets go of them a frame or two later
+	auto&& renderer = this->renderer;
+	auto buffers = this->buffers;
 
-	renderer.runOnRenderThreadSync([this]
+	renderer.runOnRenderThreadDetached([&renderer, buffers]
 		{
-			glDeleteBuffers(1, &vertexLocationBuffer);
-			glDeleteBuffers(1, &texCoordBuffer);
-			glDeleteBuffers(1, &elemBuffer);
+			auto&& deletionQueue = renderer.getDeletionQueue();
+			deletionQueue.retire(OpenGLObjectType::BUFFER, buffers->vertexLocationBuffer);
+			deletionQueue.retire(OpenGLObjectType::BUFFER, buffers->texCoordBuffer);
+			deletionQueue.retire(OpenGLObjectType::BUFFER, buffers->elemBuffer);
+			deletionQueue.retire(OpenGLObjectType::VERTEX_ARRAY, buffers->vertexArray);
 
-			glDeleteVertexArrays(1, &vertexArray);
+			delete buffers;
 		});
 }
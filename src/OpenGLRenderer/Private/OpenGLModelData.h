@@ -2,6 +2,7 @@
 
 #include "OpenGLRendererConfig.h"
 
+#include "OpenGLCullingGrid.h"
 #include "OpenGLRenderer.h"
 
 #include <ModelData.h>
@@ -12,7 +13,9 @@ class OpenGLModelData final : public ModelData
 {
 public:
 	OpenGLModelData(OpenGLRenderer& renderer)
-		: renderer(renderer)
+		: buffers(new Buffers{})
+		, localBounds{}
+		, renderer(renderer)
 		, bisInitialized(false)
 	{
 	}
@@ -25,62 +28,61 @@ public:
 	virtual bool isInitialized() override;
 	// end ModelData Interface
 
-	inline void draw();
+	/// <summary> Gets the box around the vertices, before any transform. Game thread only. </summary>
+	///
+	/// <returns> false if there aren't any vertices yet. </returns>
+	bool getLocalBounds(OpenGLBounds& bounds) const
+	{
+		bounds = localBounds;
+		return bisInitialized;
+	}
+
+	/// <summary> If the buffers have been uploaded yet. Render thread only. </summary>
+	bool isResident() const { return buffers->bisResident; }
+
+	/// <summary> Binds the VAO, which has the per-vertex attributes. The per-instance ones are up to the
+	/// caller. </summary>
+	inline void bind();
+
+	/// <summary> Draws the bound mesh numInstances times. </summary>
+	inline void drawInstances(GLsizei numInstances);
 
 private:
-	uint32 vertexArray;
-	uint32 vertexLocationBuffer;
-	uint32 texCoordBuffer;
-	uint32 elemBuffer;
+	// the GL names only exist once the render thread gets to them, so commands hold on to this instead of
+	// the model data
+	struct Buffers
+	{
+		uint32 vertexArray;
+		uint32 vertexLocationBuffer;
+		uint32 texCoordBuffer;
+		uint32 elemBuffer;
+
+		bool bisResident;
+	};
+
+	Buffers* buffers; // deleted by the render thread
 
 	size_t numVerts;
 	size_t numElems;
 
+	OpenGLBounds localBounds;
+
 	OpenGLRenderer& renderer;
 
 	bool bisInitialized;
 };
 
-inline void OpenGLModelData::draw()
+inline void OpenGLModelData::bind()
 {
+	// the per-vertex attributes and the element buffer were captured by the VAO when it was made
+	renderer.getStateCache().bindVertexArray(buffers->vertexArray);
+}
 
-	glBindVertexArray(vertexArray);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is
-	// zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexLocationBuffer);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	// bind UV data to the element attrib array so it shows up in our sahders -- the location is
-	// (look in
-	// shader)
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
-	glVertexAttribPointer(1, // location 1 (see shader)
-		2,					 // two elements per vertex (u,v)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // use the GL_ARRAY_BUFFER instead of copying on the spot
-		);
-
-	// bind the element buffer so it is used to make our draw call
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elemBuffer);
-
-	glDrawElements(GL_TRIANGLES, // they are trianges
-		(GLsizei)numElems * 3,   // these many trainges - three verts / triangle
-		GL_UNSIGNED_INT,		 // the data is uint32 - unsigned int
-		nullptr					 // use the buffer instead of raw data
-		);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+inline void OpenGLModelData::drawInstances(GLsizei numInstances)
+{
+	glDrawElementsInstanced(GL_TRIANGLES, // they are trianges
+		(GLsizei)numElems * 3,			  // these many trainges - three verts / triangle
+		GL_UNSIGNED_INT,				  // the data is uint32 - unsigned int
+		nullptr,						  // use the buffer instead of raw data
+		numInstances);
 }
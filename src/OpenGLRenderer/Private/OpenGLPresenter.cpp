@@ -0,0 +1,180 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLPresenter.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLMaterialSource.h"
+#include "OpenGLStateCache.h"
+
+OpenGLPresenter::OpenGLPresenter(OpenGLStateCache& stateCache)
+	: stateCache(stateCache)
+	, settings{4, false, 1, 2}
+	, fxaaSource(nullptr)
+	, size(0)
+	, sceneFramebuffer(0)
+	, sceneColor(0)
+	, sceneDepth(0)
+	, resolveFramebuffer(0)
+	, resolveTexture(0)
+	, emptyVertexArray(0)
+{
+}
+
+void OpenGLPresenter::init(GLFWwindow* window)
+{
+	int32 swapInterval = settings.swapInterval;
+	if (swapInterval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+		&& !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		MFLOG(Warning) << "Adaptive vsync isn't supported by this driver. Using a swap interval of 1.";
+		swapInterval = 1;
+	}
+	glfwSwapInterval(swapInterval);
+
+	glfwGetFramebufferSize(window, &size.x, &size.y);
+
+	if (settings.bfxaa) createFramebuffers();
+}
+
+void OpenGLPresenter::beginFrame()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void OpenGLPresenter::endScene()
+{
+	// without FXAA the scene is in the window's framebuffer already
+	if (sceneFramebuffer == 0) return;
+
+	if (resolveFramebuffer != 0) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+		glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// copied over as it is until the program has linked
+	if (!fxaaSource || !fxaaSource->isResident()) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer != 0 ? resolveFramebuffer : sceneFramebuffer);
+		glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return;
+	}
+
+	stateCache.useProgram(**fxaaSource);
+
+	GLint unit = 0;
+	GLint texUniLoc = fxaaSource->startTexUniform;
+	if (stateCache.shouldSetUniform(texUniLoc, &unit, sizeof(unit))) glUniform1i(texUniLoc, unit);
+	stateCache.bindTexture(unit, resolveTexture);
+
+	if (emptyVertexArray == 0) glGenVertexArrays(1, &emptyVertexArray);
+	stateCache.bindVertexArray(emptyVertexArray);
+
+	// one triangle over the whole screen, made up in the vertex shader
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void OpenGLPresenter::present(GLFWwindow* window)
+{
+	glfwSwapBuffers(window);
+
+	frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+	// a second at most -- if the GPU is that far behind, waiting longer won't help
+	const GLuint64 maxWait = 1000000000;
+	while (frameFences.size() >= settings.numBuffers) {
+		glClientWaitSync(frameFences.front(), GL_SYNC_FLUSH_COMMANDS_BIT, maxWait);
+		glDeleteSync(frameFences.front());
+		frameFences.pop_front();
+	}
+}
+
+void OpenGLPresenter::releaseBuffers(OpenGLDeletionQueue& deletionQueue)
+{
+	deletionQueue.retire(OpenGLObjectType::FRAMEBUFFER, sceneFramebuffer);
+	deletionQueue.retire(OpenGLObjectType::FRAMEBUFFER, resolveFramebuffer);
+	deletionQueue.retire(OpenGLObjectType::RENDERBUFFER, sceneColor);
+	deletionQueue.retire(OpenGLObjectType::RENDERBUFFER, sceneDepth);
+	deletionQueue.retire(OpenGLObjectType::TEXTURE, resolveTexture);
+	deletionQueue.retire(OpenGLObjectType::VERTEX_ARRAY, emptyVertexArray);
+
+	sceneFramebuffer = 0;
+	resolveFramebuffer = 0;
+	sceneColor = 0;
+	sceneDepth = 0;
+	resolveTexture = 0;
+	emptyVertexArray = 0;
+
+	for (auto&& fence : frameFences) {
+		glDeleteSync(fence);
+	}
+	frameFences.clear();
+}
+
+void OpenGLPresenter::createFramebuffers()
+{
+	// FXAA reads it with bilinear filtering, to find edges between pixels
+	glGenTextures(1, &resolveTexture);
+	stateCache.bindTexture(0, resolveTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenRenderbuffers(1, &sceneDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+	glRenderbufferStorageMultisample(
+		GL_RENDERBUFFER, settings.numSamples, GL_DEPTH_COMPONENT24, size.x, size.y);
+
+	glGenFramebuffers(1, &sceneFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+
+	if (settings.numSamples > 0) {
+		// drawn multisampled, then resolved into the texture
+		glGenRenderbuffers(1, &sceneColor);
+		glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, settings.numSamples, GL_RGBA8, size.x, size.y);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+
+		glGenFramebuffers(1, &resolveFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolveTexture, 0);
+	}
+	else
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolveTexture, 0);
+	}
+
+	bool bcomplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	bcomplete = bcomplete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (!bcomplete) {
+		MFLOG(Warning) << "Couldn't make the framebuffers for FXAA with " << settings.numSamples
+					   << " samples. Drawing without anti-aliasing.";
+
+		// nothing has used them yet, so they can go right away
+		glDeleteFramebuffers(1, &sceneFramebuffer);
+		glDeleteFramebuffers(1, &resolveFramebuffer);
+		glDeleteRenderbuffers(1, &sceneColor);
+		glDeleteRenderbuffers(1, &sceneDepth);
+		glDeleteTextures(1, &resolveTexture);
+		stateCache.onDeleted(OpenGLObjectType::TEXTURE, &resolveTexture, 1);
+
+		sceneFramebuffer = 0;
+		resolveFramebuffer = 0;
+		sceneColor = 0;
+		sceneDepth = 0;
+		resolveTexture = 0;
+
+		// the window was made without samples, as FXAA was going to do it
+		settings.bfxaa = false;
+		settings.numSamples = 0;
+	}
+}
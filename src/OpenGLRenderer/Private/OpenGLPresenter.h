@@ -0,0 +1,86 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <deque>
+
+class OpenGLDeletionQueue;
+class OpenGLMaterialSource;
+class OpenGLStateCache;
+
+// How a frame gets from the renderer to the screen, out of props.json.
+struct OpenGLPresentSettings
+{
+	uint32 numSamples; // MSAA samples for the scene, 0 for none
+	bool bfxaa;		   // run FXAA over the scene before the UI goes on
+	int32 swapInterval; // vblanks a swap waits for -- 0 is no vsync, -1 adaptive where the driver has it
+	uint32 numBuffers;	// 2 or 3: how many frames can be on the screen or queued for it at once
+};
+
+// Owns where the scene is drawn and how it is shown. Without FXAA the scene goes straight into the window's
+// framebuffer, multisampled if it asked for it. With it, the scene goes into a framebuffer of its own --
+// multisampled and resolved into a texture, or into the texture directly -- and FXAA draws that into the
+// window's. The UI is drawn after either way, so text stays sharp.
+//
+// GL doesn't let a program pick how long the swap chain is, so triple buffering here is how many swapped
+// frames the GPU may still be working through before the render thread waits for the oldest one. Double
+// keeps one in flight, for less latency. Triple keeps two, so a frame that runs long doesn't stall the next.
+// Render thread only, unless noted.
+class OpenGLPresenter
+{
+public:
+	explicit OpenGLPresenter(OpenGLStateCache& stateCache);
+
+	OpenGLPresenter(const OpenGLPresenter& other) = delete;
+	OpenGLPresenter& operator=(const OpenGLPresenter& other) = delete;
+
+	/// <summary> Set it before the window is made, which reads it for its hints. Game thread only. </summary>
+	void setSettings(const OpenGLPresentSettings& newSettings) { settings = newSettings; }
+
+	/// <summary> Game thread until the window has been made, render thread after -- init turns FXAA and the
+	/// samples off if it can't make the framebuffers. </summary>
+	const OpenGLPresentSettings& getSettings() const { return settings; }
+
+	/// <summary> The samples the window's own framebuffer should have -- none if FXAA has a framebuffer of its
+	/// own. Any thread. </summary>
+	uint32 getWindowSamples() const { return settings.bfxaa ? 0 : settings.numSamples; }
+
+	/// <summary> The program FXAA runs with. Until it is resident the scene is copied over as it is. Game
+	/// thread only, before the first frame. </summary>
+	void setFXAASource(OpenGLMaterialSource* source) { fxaaSource = source; }
+
+	/// <summary> Sets the swap interval and makes the framebuffers. Right after the window's context is made
+	/// current. </summary>
+	void init(GLFWwindow* window);
+
+	/// <summary> Binds the framebuffer the scene goes into and clears it. </summary>
+	void beginFrame();
+
+	/// <summary> Runs FXAA over the scene into the window's framebuffer, if it is on, and leaves that bound
+	/// for the UI. </summary>
+	void endScene();
+
+	/// <summary> Swaps, then waits for the oldest frame if too many are still queued. </summary>
+	void present(GLFWwindow* window);
+
+	/// <summary> Hands the framebuffers and their attachments to the deletion queue. </summary>
+	void releaseBuffers(OpenGLDeletionQueue& deletionQueue);
+
+private:
+	void createFramebuffers();
+
+	OpenGLStateCache& stateCache;
+	OpenGLPresentSettings settings;
+	OpenGLMaterialSource* fxaaSource;
+
+	ivec2 size; // of the window's framebuffer, in pixels
+
+	// only with FXAA
+	GLuint sceneFramebuffer;	// what the scene is drawn into -- multisampled if there are samples
+	GLuint sceneColor;			// multisampled renderbuffer, or 0 when the scene goes into resolveTexture
+	GLuint sceneDepth;			// renderbuffer
+	GLuint resolveFramebuffer;	// only if multisampled
+	GLuint resolveTexture;		// what FXAA reads
+	GLuint emptyVertexArray;	// the full screen triangle comes from gl_VertexID, but core needs one bound
+
+	std::deque<GLsync> frameFences; // one a swapped frame the GPU may not have finished
+};
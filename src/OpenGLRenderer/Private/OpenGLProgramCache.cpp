@@ -0,0 +1,187 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLProgramCache.h"
+
+#include <cstring>
+
+#include <boost/filesystem/fstream.hpp>
+
+OpenGLProgramCache::OpenGLProgramCache()
+	: bisEnabled(true)
+	, bisSupportChecked(false)
+	, bisSupported(false)
+	, stats{}
+{
+}
+
+uint64 OpenGLProgramCache::hashSources(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	uint64 hash = 14695981039346656037ull;
+
+	auto hashBytes = [&hash](const char* bytes, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<uint8>(bytes[i]);
+			hash *= 1099511628211ull;
+		}
+	};
+
+	// the lengths go in too, so moving a line from one shader to the other changes it
+	uint64 vertexLength = vertexSource.size();
+	hashBytes(reinterpret_cast<const char*>(&vertexLength), sizeof(vertexLength));
+	hashBytes(vertexSource.data(), vertexSource.size());
+	hashBytes(fragmentSource.data(), fragmentSource.size());
+
+	return hash;
+}
+
+path_t OpenGLProgramCache::getBinaryPath(const path_t& name)
+{
+	return L"shaders\\" + name.wstring() + L".progbin";
+}
+
+std::vector<char> OpenGLProgramCache::readBinaryFile(const path_t& name) const
+{
+	std::vector<char> ret;
+	if (!bisEnabled) return ret;
+
+	boost::filesystem::ifstream stream{getBinaryPath(name), std::ios::binary | std::ios::ate};
+	if (!stream.is_open()) return ret;
+
+	ret.resize(static_cast<size_t>(stream.tellg()));
+	stream.seekg(0);
+	stream.read(ret.data(), ret.size());
+	if (!stream) ret.clear();
+
+	return ret;
+}
+
+GLuint OpenGLProgramCache::loadProgram(const path_t& name, uint64 sourceHash, const std::vector<char>& file)
+{
+	if (file.empty() || !isSupported()) return 0;
+
+	auto reject = [this, &name](const char* why)
+	{
+		MFLOG(Trace) << "\tNot using the binary for program " << name << ": " << why;
+
+		std::lock_guard<std::mutex> lock{statsMutex};
+		++stats.numStale;
+		return GLuint(0);
+	};
+
+	Header header;
+	if (file.size() < sizeof(header)) return reject("it is cut short");
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (std::strncmp(header.magic, "MFPB", 4) != 0 || header.version != currentVersion)
+		return reject("it is from another version");
+	if (file.size() != sizeof(header) + header.driverLength + header.binaryLength)
+		return reject("it is cut short");
+	if (header.sourceHash != sourceHash) return reject("the source has changed");
+
+	const char* fileDriver = file.data() + sizeof(header);
+	if (std::string(fileDriver, header.driverLength) != driver) return reject("the driver has changed");
+
+	auto start = std::chrono::steady_clock::now();
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, fileDriver + header.driverLength, header.binaryLength);
+
+	// drivers are allowed to turn down their own binaries, after an update say
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		glDeleteProgram(program);
+		return reject("the driver refused it");
+	}
+
+	auto loadTime =
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	{
+		std::lock_guard<std::mutex> lock{statsMutex};
+		++stats.numHits;
+		stats.loadTime += loadTime;
+		stats.timeSaved += std::chrono::microseconds(header.compileMicroseconds) - loadTime;
+	}
+
+	MFLOG(Trace) << "\tLoaded program " << name << " from its binary in " << loadTime.count() << "us";
+
+	return program;
+}
+
+void OpenGLProgramCache::prepareProgram(GLuint program)
+{
+	if (isSupported()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void OpenGLProgramCache::storeProgram(
+	const path_t& name, uint64 sourceHash, GLuint program, std::chrono::microseconds compileTime)
+{
+	{
+		std::lock_guard<std::mutex> lock{statsMutex};
+		++stats.numMisses;
+		stats.compileTime += compileTime;
+	}
+
+	if (!isSupported()) return;
+
+	// a program that didn't link has nothing worth keeping
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) return;
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0) return;
+
+	auto binary = std::vector<char>(binaryLength);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, binaryLength, nullptr, &binaryFormat, binary.data());
+
+	Header header;
+	std::memcpy(header.magic, "MFPB", 4);
+	header.version = currentVersion;
+	header.sourceHash = sourceHash;
+	header.binaryFormat = binaryFormat;
+	header.driverLength = static_cast<uint32>(driver.size());
+	header.binaryLength = static_cast<uint32>(binaryLength);
+	header.compileMicroseconds = static_cast<uint32>(compileTime.count());
+
+	boost::filesystem::ofstream stream{getBinaryPath(name), std::ios::binary};
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(driver.data(), driver.size());
+	stream.write(binary.data(), binary.size());
+
+	if (!stream) MFLOG(Warning) << "Could not write the binary for program " << name;
+}
+
+OpenGLProgramCacheStats OpenGLProgramCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock{statsMutex};
+	return stats;
+}
+
+bool OpenGLProgramCache::isSupported()
+{
+	if (bisSupportChecked) return bisSupported;
+	bisSupportChecked = true;
+
+	if (!bisEnabled) return bisSupported = false;
+
+	// core from 4.1, and this is a 3.3 context
+	GLint numFormats = 0;
+	if (GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	if (numFormats == 0) {
+		MFLOG(Trace) << "The driver can't give back program binaries, so every program will be compiled";
+		return bisSupported = false;
+	}
+
+	driver = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+	driver += '|';
+	driver += reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	driver += '|';
+	driver += reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+	return bisSupported = true;
+}
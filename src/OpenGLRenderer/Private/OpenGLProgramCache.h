@@ -0,0 +1,94 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct OpenGLProgramCacheStats
+{
+	uint32 numHits;							// programs that came from a binary
+	uint32 numMisses;						// programs that had to be compiled
+	uint32 numStale;						// binaries that were for other source or another driver, or refused
+	std::chrono::microseconds loadTime;		// spent in glProgramBinary
+	std::chrono::microseconds compileTime;	// spent compiling and linking the misses
+	std::chrono::microseconds timeSaved;	// what the hits took to compile when they were stored, less loadTime
+};
+
+// Keeps linked programs as driver binaries next to their shaders, so later launches can skip compiling. A
+// binary is only used for the exact source it was made from on the exact driver that made it -- anything else
+// and the program is compiled as usual and the binary replaced.
+//
+// On disk it is the header, then the driver string, then the binary.
+class OpenGLProgramCache
+{
+public:
+	struct Header
+	{
+		char magic[4]; // "MFPB"
+		uint32 version;
+		uint64 sourceHash;
+		uint32 binaryFormat;
+		uint32 driverLength;
+		uint32 binaryLength;
+		uint32 compileMicroseconds; // how long it took to make, for timeSaved
+	};
+
+	static const uint32 currentVersion = 1;
+
+	OpenGLProgramCache();
+
+	OpenGLProgramCache(const OpenGLProgramCache& other) = delete;
+	OpenGLProgramCache& operator=(const OpenGLProgramCache& other) = delete;
+
+	/// <summary> Turns the cache on or off. Set it before any program is made. </summary>
+	void setEnabled(bool bEnabled) { bisEnabled = bEnabled; }
+
+	/// <summary> If binaries should be read and written at all. The driver may still not support them.
+	/// Safe from any thread. </summary>
+	bool isEnabled() const { return bisEnabled; }
+
+	/// <summary> FNV-1a over both sources, with the split between them kept. </summary>
+	static uint64 hashSources(const std::string& vertexSource, const std::string& fragmentSource);
+
+	/// <summary> Where the binary for the program called name goes. </summary>
+	static path_t getBinaryPath(const path_t& name);
+
+	/// <summary> Reads the binary for name, so the render thread doesn't wait on the file. Any thread.
+	/// </summary>
+	///
+	/// <returns> The file, or nothing if the cache is off or there isn't one. </returns>
+	std::vector<char> readBinaryFile(const path_t& name) const;
+
+	/// <summary> Makes a program out of file, if it was made from the same source on this driver. Render
+	/// thread only. </summary>
+	///
+	/// <returns> The linked program, or 0 if it has to be compiled. </returns>
+	GLuint loadProgram(const path_t& name, uint64 sourceHash, const std::vector<char>& file);
+
+	/// <summary> Asks the driver to keep program's binary around. Call between creating and linking it.
+	/// Render thread only. </summary>
+	void prepareProgram(GLuint program);
+
+	/// <summary> Writes a freshly linked program's binary out for next time, if it linked. Render thread only.
+	/// </summary>
+	void storeProgram(
+		const path_t& name, uint64 sourceHash, GLuint program, std::chrono::microseconds compileTime);
+
+	/// <summary> Safe from any thread. </summary>
+	OpenGLProgramCacheStats getStats() const;
+
+private:
+	/// <summary> Checks for driver support and gets the driver string, the first time. Render thread only.
+	/// </summary>
+	bool isSupported();
+
+	bool bisEnabled;
+	bool bisSupportChecked;
+	bool bisSupported;
+	std::string driver; // vendor, renderer and version -- a binary from any other is no good
+
+	mutable std::mutex statsMutex;
+	OpenGLProgramCacheStats stats;
+};
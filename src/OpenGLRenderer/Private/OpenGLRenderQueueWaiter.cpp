@@ -0,0 +1,64 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLRenderQueueWaiter.h"
+
+#include <Logging.h>
+
+#include <boost/algorithm/string.hpp>
+
+OpenGLRenderQueueWaiter::OpenGLRenderQueueWaiter(
+	RenderQueueWaitStrategy strategy, uint32 spinCount, uint32 yieldCount)
+	: strategy(strategy)
+	, spinCount(spinCount)
+	, yieldCount(yieldCount)
+	, isSleeping(false)
+	, numParks(0)
+	, numWakeups(0)
+	, idleNanoseconds(0)
+{
+}
+
+void OpenGLRenderQueueWaiter::setStrategy(
+	RenderQueueWaitStrategy newStrategy, uint32 newSpinCount, uint32 newYieldCount)
+{
+	strategy = newStrategy;
+	spinCount = newSpinCount;
+	yieldCount = newYieldCount;
+}
+
+void OpenGLRenderQueueWaiter::notify()
+{
+	// pairs with the fence in park
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (isSleeping) {
+		// take the lock so we can't notify between the consumer checking for work and it waiting
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+		}
+		condition.notify_one();
+	}
+}
+
+RenderQueueWaitStats OpenGLRenderQueueWaiter::getStats() const
+{
+	RenderQueueWaitStats ret;
+
+	ret.numParks = numParks;
+	ret.numWakeups = numWakeups;
+	ret.idleTime = std::chrono::nanoseconds(idleNanoseconds.load());
+
+	return ret;
+}
+
+RenderQueueWaitStrategy OpenGLRenderQueueWaiter::strategyFromString(const std::string& name)
+{
+	if (boost::algorithm::iequals(name, "spin")) return RenderQueueWaitStrategy::SPIN;
+	if (boost::algorithm::iequals(name, "yield")) return RenderQueueWaitStrategy::YIELD;
+	if (boost::algorithm::iequals(name, "block")) return RenderQueueWaitStrategy::BLOCK;
+	if (boost::algorithm::iequals(name, "adaptive")) return RenderQueueWaitStrategy::ADAPTIVE;
+
+	MFLOG(Warning) << "Unrecognized render queue wait strategy: " << name << ". Using adaptive.";
+
+	return RenderQueueWaitStrategy::ADAPTIVE;
+}
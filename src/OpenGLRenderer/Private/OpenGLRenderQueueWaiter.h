@@ -0,0 +1,136 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// how the render thread waits when there is nothing in the queue
+enum class RenderQueueWaitStrategy : uint8
+{
+	SPIN = 0,	 // never give up the core -- lowest latency, burns a whole core
+	YIELD = 1,	// std::this_thread::yield between checks
+	BLOCK = 2,	// park on a condition variable right away
+	ADAPTIVE = 3, // spin for a bit, then yield for a bit, then park
+};
+
+struct RenderQueueWaitStats
+{
+	uint64 numParks;   // times the render thread went to sleep
+	uint64 numWakeups; // times a producer woke the render thread back up
+	std::chrono::nanoseconds idleTime; // total time spent waiting for work
+};
+
+class OpenGLRenderQueueWaiter
+{
+public:
+	explicit OpenGLRenderQueueWaiter(RenderQueueWaitStrategy strategy = RenderQueueWaitStrategy::ADAPTIVE,
+		uint32 spinCount = 4000,
+		uint32 yieldCount = 64);
+
+	OpenGLRenderQueueWaiter(const OpenGLRenderQueueWaiter& other) = delete;
+	OpenGLRenderQueueWaiter& operator=(const OpenGLRenderQueueWaiter& other) = delete;
+
+	void setStrategy(RenderQueueWaitStrategy newStrategy, uint32 newSpinCount, uint32 newYieldCount);
+	RenderQueueWaitStrategy getStrategy() const { return strategy; }
+
+	/// <summary> Called from the consumer. Returns once hasWork returns true. </summary>
+	///
+	/// <param name="hasWork"> Must be safe to call without holding any locks. </param>
+	template <typename Predicate>
+	inline void wait(Predicate&& hasWork);
+
+	/// <summary> Called from producers after they have pushed work. Cheap if the consumer is awake.
+	/// </summary>
+	void notify();
+
+	RenderQueueWaitStats getStats() const;
+
+	static RenderQueueWaitStrategy strategyFromString(const std::string& name);
+
+private:
+	template <typename Predicate>
+	inline void park(Predicate& hasWork);
+
+	RenderQueueWaitStrategy strategy;
+	uint32 spinCount;
+	uint32 yieldCount;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<bool> isSleeping;
+
+	std::atomic<uint64> numParks;
+	std::atomic<uint64> numWakeups;
+	std::atomic<int64> idleNanoseconds;
+};
+
+template <typename Predicate>
+inline void OpenGLRenderQueueWaiter::wait(Predicate&& hasWork)
+{
+	if (hasWork()) return;
+
+	auto idleStart = std::chrono::steady_clock::now();
+
+	switch (strategy)
+	{
+	case RenderQueueWaitStrategy::SPIN:
+		while (!hasWork())
+			;
+		break;
+	case RenderQueueWaitStrategy::YIELD:
+		while (!hasWork()) std::this_thread::yield();
+		break;
+	case RenderQueueWaitStrategy::BLOCK: park(hasWork); break;
+	case RenderQueueWaitStrategy::ADAPTIVE:
+	default:
+	{
+		uint32 spins = 0;
+		uint32 yields = 0;
+
+		while (!hasWork()) {
+			if (spins < spinCount) {
+				++spins;
+			}
+			else if (yields < yieldCount)
+			{
+				++yields;
+				std::this_thread::yield();
+			}
+			else
+			{
+				park(hasWork);
+				break;
+			}
+		}
+		break;
+	}
+	}
+
+	idleNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - idleStart).count();
+}
+
+template <typename Predicate>
+inline void OpenGLRenderQueueWaiter::park(Predicate& hasWork)
+{
+	std::unique_lock<std::mutex> lock{mutex};
+
+	isSleeping = true;
+	// pairs with the fence in notify -- either we see their push or they see us sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (!hasWork()) {
+		++numParks;
+		condition.wait(lock, [&hasWork]
+			{
+				return hasWork();
+			});
+		++numWakeups;
+	}
+
+	isSleeping = false;
+}
@@ -16,6 +16,7 @@
 #include <SOIL/SOIL.h>
 
 #include <Runtime.h>
+#include <PropertyManager.h>
 #include <Renderer.h>
 #include <Helper.h>
 #include <Logging.h>
@@ -26,19 +27,236 @@
 #include <functional>
 #include <algorithm>
 #include <future>
+#include <unordered_map>
 
 #include <boost/timer/timer.hpp>
 
+namespace
+{
+// the renderers that are alive, by generation -- a thread that exits after its renderer has gone mustn't
+// hand its list back to it
+std::mutex liveRenderersMutex;
+std::unordered_map<uint64, OpenGLRenderer*> liveRenderers;
+uint64 nextGeneration = 1; // 0 is no renderer
+
+uint64 addLiveRenderer(OpenGLRenderer* renderer)
+{
+	std::lock_guard<std::mutex> lock{liveRenderersMutex};
+
+	uint64 generation = nextGeneration++;
+	liveRenderers[generation] = renderer;
+
+	return generation;
+}
+}
+
+// One a thread, for as long as it lives. Gives the list back when the thread exits, so short lived threads
+// don't use the slots up.
+struct OpenGLRenderer::ThreadCommandListCache
+{
+	OpenGLThreadCommandList* list = nullptr;
+	uint64 generation = 0; // of the renderer list is from
+
+	~ThreadCommandListCache() { release(); }
+
+	void release()
+	{
+		if (!list) return;
+
+		std::lock_guard<std::mutex> lock{liveRenderersMutex};
+		auto iter = liveRenderers.find(generation);
+		if (iter != liveRenderers.end()) iter->second->releaseThreadCommandList(*list);
+
+		list = nullptr;
+		generation = 0;
+	}
+};
+
 OpenGLRenderer::OpenGLRenderer()
-	: queue(100)
-	, modelsToDelete(1000)
-	, modelsToAdd(1000)
-	, models(*this)
-	, textBoxes(*this)
+	: numCommandLists(0)
+	, generation(addLiveRenderer(this))
+	, queueHighWaterMark(8192)
+	, queueLowWaterMark(2048)
+	, frameLatency(2)
+	, recordingBuffer(0)
+	, framesSubmitted(0)
+	, framesCompleted(0)
+	, deletionQueue(stateCache)
+	, batcher(stateCache)
+	, textureLoader(stateCache, deletionQueue, textureResidency)
+	, textureResidency(deletionQueue, textureLoader)
+	, debugDraw(stateCache)
+	, textRenderer(stateCache, textureResidency)
+	, presenter(stateCache)
+	, cameraBuffer(0)
+	, renderThread(queueWaiter)
+	, lastCullStats{}
 {
+	PropertyManager& propManager = Runtime::get().getPropertyManager();
+
+	std::string waitStrategy = "adaptive";
+	uint32 waitSpinCount = 4000;
+	uint32 waitYieldCount = 64;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.waitStrategy", waitStrategy, "adaptive");
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.waitSpinCount", waitSpinCount, 4000);
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.waitYieldCount", waitYieldCount, 64);
+
+	queueWaiter.setStrategy(
+		OpenGLRenderQueueWaiter::strategyFromString(waitStrategy), waitSpinCount, waitYieldCount);
+	frameWaiter.setStrategy(
+		OpenGLRenderQueueWaiter::strategyFromString(waitStrategy), waitSpinCount, waitYieldCount);
+
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.queueHighWaterMark", queueHighWaterMark, 8192);
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.queueLowWaterMark", queueLowWaterMark, 2048);
+	if (queueLowWaterMark > queueHighWaterMark) {
+		MFLOG(Warning) << "Renderer.queueLowWaterMark is above Renderer.queueHighWaterMark. Using "
+					   << queueHighWaterMark << " for both.";
+
+		queueLowWaterMark = queueHighWaterMark;
+	}
+
+	lastFrameQueueStats = worstFrameQueueStats = RenderQueueFrameStats{};
+
+	float cullCellSize = 32.f;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.cullCellSize", cullCellSize, 32.f);
+	if (cullCellSize <= 0.f) {
+		MFLOG(Warning) << "Renderer.cullCellSize must be above 0, was " << cullCellSize << ". Using 32.";
+
+		cullCellSize = 32.f;
+	}
+	cullingGrid.setCellSize(cullCellSize);
+
+	uint32 textureLoaderThreads = 2;
+	uint32 textureUploadBudget = 4 * 1024 * 1024;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.textureLoaderThreads", textureLoaderThreads, 2);
+	LOAD_PROPERTY_WITH_WARNING(
+		propManager, "Renderer.textureUploadBudget", textureUploadBudget, 4 * 1024 * 1024);
+	if (textureLoaderThreads == 0) textureLoaderThreads = 1;
+
+	textureLoader.start(textureLoaderThreads, textureUploadBudget);
+
+	// in bytes, estimated -- 0 keeps everything
+	uint32 textureBudget = 256 * 1024 * 1024;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.textureBudget", textureBudget, 256 * 1024 * 1024);
+	textureResidency.setBudget(textureBudget);
+
+	bool bUseProgramCache = true;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.programCache", bUseProgramCache, true);
+	programCache.setEnabled(bUseProgramCache);
+
+	OpenGLPresentSettings presentSettings;
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.msaaSamples", presentSettings.numSamples, 4);
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.fxaa", presentSettings.bfxaa, false);
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.swapInterval", presentSettings.swapInterval, 1);
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.buffering", presentSettings.numBuffers, 2);
+	uint32 samples = presentSettings.numSamples;
+	if (samples == 1 || samples > 16 || (samples & (samples - 1)) != 0) {
+		MFLOG(Warning) << "Renderer.msaaSamples must be 0, 2, 4, 8 or 16, was " << samples << ". Using 4.";
+
+		presentSettings.numSamples = 4;
+	}
+	if (presentSettings.numBuffers != 2 && presentSettings.numBuffers != 3) {
+		MFLOG(Warning) << "Renderer.buffering must be 2 or 3, was " << presentSettings.numBuffers
+					   << ". Using 2.";
+
+		presentSettings.numBuffers = 2;
+	}
+	presenter.setSettings(presentSettings);
+
+	LOAD_PROPERTY_WITH_WARNING(propManager, "Renderer.frameLatency", frameLatency, 2);
+	if (frameLatency < 1 || frameLatency > maxFrameLatency) {
+		MFLOG(Warning) << "Renderer.frameLatency must be between 1 and " << maxFrameLatency << ", was "
+					   << frameLatency << ". Clamping.";
+
+		frameLatency = frameLatency < 1 ? 1 : maxFrameLatency;
+	}
 }
 
-OpenGLRenderer::~OpenGLRenderer() = default;
+OpenGLRenderer::~OpenGLRenderer()
+{
+	// threads that exit from here on keep their lists -- they all go with the renderer
+	{
+		std::lock_guard<std::mutex> lock{liveRenderersMutex};
+		liveRenderers.erase(generation);
+	}
+
+	// nothing can be in flight once the models go away
+	waitForAllFrames();
+	releaseRetiredModels();
+
+	auto&& deletionStats = runOnRenderThreadSync([this]
+		{
+			batcher.releaseBuffers(deletionQueue);
+			textureLoader.releaseBuffers();
+			debugDraw.releaseBuffers(deletionQueue);
+			textRenderer.releaseBuffers(deletionQueue);
+			presenter.releaseBuffers(deletionQueue);
+			deletionQueue.retire(OpenGLObjectType::BUFFER, cameraBuffer);
+
+			deletionQueue.flush();
+			return deletionQueue.getStats();
+		});
+
+	auto&& batchStats = batcher.getStats();
+	MFLOG(Trace) << "Last frame drew " << batchStats.numModels << " models, " << batchStats.numOpaqueModels
+				 << " of them opaque, in " << batchStats.numDrawCalls << " draw calls";
+	auto&& unsorted = batchStats.unsortedChanges;
+	auto&& sorted = batchStats.sortedChanges;
+	MFLOG(Trace) << "Sorting took it from " << unsorted.programChanges << " program, "
+				 << unsorted.materialChanges << " material and " << unsorted.meshChanges
+				 << " mesh changes to " << sorted.programChanges << ", " << sorted.materialChanges << " and "
+				 << sorted.meshChanges;
+
+	MFLOG(Trace) << "Last frame culled " << lastCullStats.numCulled << " of " << lastCullStats.numModels
+				 << " models, checking the bounds of " << lastCullStats.numTested;
+
+	auto&& stateStats = stateCache.getStats();
+	auto issued = stateStats.programs.issued + stateStats.vertexArrays.issued + stateStats.textures.issued
+		+ stateStats.uniformBuffers.issued + stateStats.uniforms.issued;
+	auto elided = stateStats.programs.elided + stateStats.vertexArrays.elided + stateStats.textures.elided
+		+ stateStats.uniformBuffers.elided + stateStats.uniforms.elided;
+	MFLOG(Trace) << "Last frame issued " << issued << " GL state calls and skipped " << elided << " ("
+				 << stateStats.uniforms.elided << " of them uniforms)";
+
+	MFLOG(Trace) << "Deletion queue freed " << deletionStats.numFreed << " GL objects in "
+				 << deletionStats.numBatchesFreed << " batches";
+
+	auto&& textureStats = textureLoader.getStats();
+	MFLOG(Trace) << "Texture loader uploaded " << textureStats.numLoaded << " textures ("
+				 << textureStats.bytesUploaded / 1024 << "KiB), failed " << textureStats.numFailed
+				 << " and spent "
+				 << std::chrono::duration_cast<std::chrono::milliseconds>(textureStats.decodeTime).count()
+				 << "ms decoding";
+
+	auto&& residencyStats = textureResidency.getStats();
+	MFLOG(Trace) << "Textures took up to " << residencyStats.peakResidentBytes / (1024 * 1024) << "MiB of a "
+				 << residencyStats.budget / (1024 * 1024) << "MiB budget, with " << residencyStats.numEvictions
+				 << " evicted and " << residencyStats.numReloads << " loaded again";
+
+	auto&& programStats = programCache.getStats();
+	MFLOG(Trace) << "Program cache loaded " << programStats.numHits << " programs from binaries and compiled "
+				 << programStats.numMisses << " (" << programStats.numStale << " binaries out of date), saving "
+				 << std::chrono::duration_cast<std::chrono::milliseconds>(programStats.timeSaved).count()
+				 << "ms of compiling";
+
+	auto&& stats = queueWaiter.getStats();
+	auto idleMs = std::chrono::duration_cast<std::chrono::milliseconds>(stats.idleTime).count();
+
+	MFLOG(Trace) << "Render thread parked " << stats.numParks << " times, woken " << stats.numWakeups
+				 << " times, idle for " << idleMs << "ms";
+
+	auto worstStallUs =
+		std::chrono::duration_cast<std::chrono::microseconds>(worstFrameQueueStats.stallTime).count();
+
+	MFLOG(Trace) << "Worst frame for the render queues: " << worstFrameQueueStats.peakDepth
+				 << " commands deep, " << worstFrameQueueStats.numStalls << " stalls, " << worstStallUs
+				 << "us stalled";
+
+	for (auto&& threadStats : getSubmissionStats()) {
+		MFLOG(Trace) << "Thread " << threadStats.threadID << " submitted " << threadStats.numImmediateCommands
+					 << " immediate and " << threadStats.numRecordedCommands << " recorded render commands";
+	}
+}
 
 void OpenGLRenderer::init()
 {
@@ -55,25 +273,115 @@ void OpenGLRenderer::init()
 void OpenGLRenderer::renderLoop()
 {
 	while (renderThread.isInLoop) {
-		while (queue.empty() && renderThread.isInLoop)
-			;
-
-		queue.consume_all([](const std::function<void()>& fun)
+		queueWaiter.wait([this]
 			{
-				fun();
+				return hasImmediateCommands() || !renderThread.isInLoop;
 			});
+
+		// registration order keeps this deterministic
+		uint32 numLists = numCommandLists;
+		for (uint32 i = 0; i < numLists; ++i) {
+			commandLists[i]->queue.consume_all([](const std::function<void()>& fun)
+				{
+					fun();
+				});
+		}
+	}
+}
+
+OpenGLThreadCommandList& OpenGLRenderer::getThreadCommandList()
+{
+	static thread_local ThreadCommandListCache cache;
+
+	if (cache.list && cache.generation == generation) return *cache.list;
+
+	// it was submitting to another renderer
+	cache.release();
+
+	std::lock_guard<std::mutex> lock{commandListMutex};
+
+	OpenGLThreadCommandList* list;
+	if (!freeCommandLists.empty()) {
+		// what the last thread left in it goes first, which is the order it was submitted in anyway
+		list = commandLists[freeCommandLists.back()].get();
+		freeCommandLists.pop_back();
+
+		list->threadID = std::this_thread::get_id();
+	}
+	else
+	{
+		uint32 index = numCommandLists;
+		if (index >= maxCommandLists) {
+			MFLOG(Fatal) << "More than " << maxCommandLists << " threads are submitting render commands at once.";
+		}
+
+		commandLists[index] = std::make_unique<OpenGLThreadCommandList>(
+			index, std::this_thread::get_id(), queueHighWaterMark, queueLowWaterMark);
+		numCommandLists = index + 1; // publish it to the render thread
+
+		list = commandLists[index].get();
+	}
+
+	cache.list = list;
+	cache.generation = generation;
+
+	return *list;
+}
+
+void OpenGLRenderer::releaseThreadCommandList(OpenGLThreadCommandList& list)
+{
+	std::lock_guard<std::mutex> lock{commandListMutex};
+	freeCommandLists.push_back(list.index);
+}
+
+void OpenGLRenderer::pushImmediateCommand(std::function<void()>&& func)
+{
+	auto&& list = getThreadCommandList();
+
+	list.queue.push(std::move(func));
+	++list.numImmediateCommands;
+
+	queueWaiter.notify();
+}
+
+bool OpenGLRenderer::hasImmediateCommands() const
+{
+	uint32 numLists = numCommandLists;
+	for (uint32 i = 0; i < numLists; ++i) {
+		if (commandLists[i]->queue.read_available() != 0) return true;
+	}
+
+	return false;
+}
+
+std::vector<RenderSubmissionStats> OpenGLRenderer::getSubmissionStats() const
+{
+	std::vector<RenderSubmissionStats> ret;
+
+	uint32 numLists = numCommandLists;
+	for (uint32 i = 0; i < numLists; ++i) {
+		ret.push_back(commandLists[i]->getStats());
 	}
+
+	return ret;
 }
 
 void OpenGLRenderer::initRenderer()
 {
 
+	// read before the window is made -- the render thread turns FXAA off if it can't make its framebuffers
+	bool bfxaa = presenter.getSettings().bfxaa;
+
 	window = std::make_unique<OpenGLWindowWidget>(*this);
-	debugDraw = std::make_unique<OpenGLMaterialInstance>(*this, getMaterialSource("debugdraw"));
+	debugDrawMaterial = std::make_unique<OpenGLMaterialInstance>(*this, getMaterialSource("debugdraw"));
+	if (bfxaa) presenter.setFXAASource(static_cast<OpenGLMaterialSource*>(getMaterialSource("fxaa")));
 
-	runOnRenderThreadAsync([]
+	runOnRenderThreadDetached([]
 		{
+			// the batcher turns it on for the models. Equal render orders pass, so the later one wins like
+			// it did without depth.
 			glDisable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LEQUAL);
 
 			glEnable(GL_BLEND);
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -100,14 +408,62 @@ const WindowWidget* OpenGLRenderer::getWindow() const
 
 std::unique_ptr<Model, decltype(&Model::deleter)> OpenGLRenderer::newModel(uint8 renderOrder)
 {
+	assert(!isOnRenderThread());
+
 	auto&& ret =
 		std::unique_ptr<OpenGLModel, void (*)(Model*)>(new OpenGLModel(*this, renderOrder), &Model::deleter);
 
-	modelsToAdd.push(ret.get());
+	addModelSlot(*ret);
 
 	return std::move(ret);
 }
 
+void OpenGLRenderer::addModelSlot(OpenGLModel& model)
+{
+	if (freeModelSlots.empty()) {
+		model.slot = static_cast<uint32>(models.size());
+		models.push_back(&model);
+	}
+	else
+	{
+		model.slot = freeModelSlots.back();
+		freeModelSlots.pop_back();
+
+		models[model.slot] = &model;
+	}
+}
+
+void OpenGLRenderer::removeModelSlot(OpenGLModel& model)
+{
+	models[model.slot] = nullptr;
+	freeModelSlots.push_back(model.slot);
+}
+
+void OpenGLRenderer::moveModelToGrid(OpenGLModel& model, const OpenGLBounds& bounds)
+{
+	assert(!model.bisInGrid);
+
+	removeModelSlot(model);
+	cullingGrid.insert(model, bounds);
+	model.bisInGrid = true;
+}
+
+void OpenGLRenderer::removeModelFromGrid(OpenGLModel& model)
+{
+	assert(model.bisInGrid);
+
+	cullingGrid.remove(model);
+	model.bisInGrid = false;
+	addModelSlot(model);
+}
+
+void OpenGLRenderer::retireFrameResource(std::shared_ptr<void> resource)
+{
+	assert(!isOnRenderThread());
+
+	if (resource) retiredFrameResources.emplace_back(framesSubmitted, std::move(resource));
+}
+
 std::unique_ptr<MFUI::TextBoxWidget> OpenGLRenderer::newTextBoxWidget(Widget* owner)
 {
 	return std::make_unique<OpenGLTextBoxWidget>(owner, *this);
@@ -142,6 +498,14 @@ std::unique_ptr<TextureLibrary> OpenGLRenderer::newTextureLibrary()
 	return std::make_unique<OpenGLTextureLibrary>(*this);
 }
 
+std::unique_ptr<Texture> OpenGLRenderer::newTileIndexTexture(uvec2 size, const uint16* indices)
+{
+	auto ret = std::make_unique<OpenGLTexture>(*this);
+	ret->initTileIndices(size, indices);
+
+	return ret;
+}
+
 std::unique_ptr<MaterialInstance> OpenGLRenderer::newMaterialInstance(MaterialSource* source)
 {
 	return std::make_unique<OpenGLMaterialInstance>(*this, source);
@@ -162,84 +526,267 @@ void OpenGLRenderer::deleteModel(Model* model)
 	assert(!isOnRenderThread());
 
 	auto casted = static_cast<OpenGLModel*>(model);
-	bool b = true;
-	while (!casted->isValid.compare_exchange_weak(
-		b, false)) // get rid of the race condition of models being deleted while rendering them
+
+	if (casted->bisInGrid) {
+		cullingGrid.remove(*casted);
+		casted->bisInGrid = false;
+	}
+	else
 	{
-		b = true;
+		removeModelSlot(*casted);
 	}
-	assert(!casted->isValid);
-	modelsToDelete.push(casted);
+
+	// frames that have already been submitted can still draw it, so hold on until they are done
+	retiredModels.emplace_back(framesSubmitted, casted);
 }
 
 bool OpenGLRenderer::update(float /*deltaTime*/)
 {
 
-	// wait for the last frame's rendering to finish
-	if (lastFrame.valid()) lastFrame.wait();
+	// wait until the render thread is few enough frames behind
+	waitForFrameSlot();
+	releaseRetiredModels();
 
-	runOnRenderThreadAsync([]
+	recordRenderCommand([this]
 		{
-			glClear(GL_COLOR_BUFFER_BIT);
+			presenter.beginFrame();
 		});
 
-	// call the draw function for all of the models in order of render order
-	runOnRenderThreadAsync([this]
+	recordFramePacket();
+
+	// the batcher only has the depth test on for the models, so these just go on top
+	Runtime::get().getPhysicsSystem().drawDebugPoints(); // TODO: Better system here
+	recordDebugDraw();
+
+	// FXAA goes over the scene, but not the UI
+	recordRenderCommand([this]
 		{
-			for (auto&& renderLevel : models.get()) {
-				for (auto&& elem : renderLevel.second) {
-					elem->draw();
-				}
-			}
+			presenter.endScene();
 		});
 
-	// runOnRenderThreadAsync([]
-	//	{
-	//		glDisable(GL_DEPTH_TEST);
-	//	});
+	float aspectRatio = static_cast<float>(window->getSize().x) / static_cast<float>(window->getSize().y);
+	auto defMat = glm::ortho2d(0.f, aspectRatio, 1.f, 0.f);
 
-	Runtime::get().getPhysicsSystem().drawDebugPoints(); // TODO: Better system here
+	// the UI is only drawn again when something in it changed -- otherwise the last pass's glyphs are reused
+	if (window->needsDrawing(defMat)) {
+		textRenderer.beginUI();
+		window->draw(defMat);
+		window->drawSubObjects(defMat);
+	}
+	recordText(); // before the swap in postDraw
+	window->postDraw(defMat);
+
+	submitFrame();
 
-	// runOnRenderThreadAsync([]
-	//	{
-	//		glEnable(GL_DEPTH_TEST);
-	//	});
-	runOnRenderThreadAsync([this]
+	shouldExit = window->shouldClose();
+
+	return !shouldExit;
+}
+
+void OpenGLRenderer::waitForFrameSlot()
+{
+	frameWaiter.wait([this]
 		{
-			modelsToAdd.consume_all([this](OpenGLModel* elem)
-				{
-					auto&& list = models.get()[elem->getRenderOrder()];
-					list.push_front(elem);
+			return framesSubmitted - framesCompleted.load() < frameLatency;
+		});
+}
 
-					elem->location = list.begin();
-				});
+void OpenGLRenderer::waitForAllFrames()
+{
+	frameWaiter.wait([this]
+		{
+			return framesCompleted.load() >= framesSubmitted;
 		});
+}
+
+void OpenGLRenderer::recordFramePacket()
+{
+	size_t numModels = models.size() - freeModelSlots.size() + cullingGrid.size();
+
+	auto draws = allocateRenderData<OpenGLDrawPacket>(numModels);
+	size_t numDraws = 0;
 
-	runOnRenderThreadAsync([this]
+	// once a frame, for everything drawn in it
+	mat3 view = getCurrentCamera().getViewMat();
+
+	// what the camera can see is the screen, taken back through the view
+	OpenGLBounds viewBounds = OpenGLBounds::transformed(glm::inverse(view), vec2(-1.f), vec2(1.f));
+
+	RenderCullStats cullStats{};
+	cullStats.numModels = numModels;
+
+	// debug shapes added from here on are culled to the same view
+	debugDraw.beginFrame(viewBounds);
+
+	// static models, from the cells around the view
+	cullStats.numTested += cullingGrid.query(viewBounds, [&](OpenGLModel& model)
 		{
-			modelsToDelete.consume_all([this](OpenGLModel* elem)
-				{
-					assert(!elem->isValid);
-					auto&& list = models.get()[elem->OpenGLModel::getRenderOrder()];
-					list.erase(elem->location);
-					delete elem;
-				});
+			++cullStats.numVisible;
+			if (model.snapshot(model.getModelMatrix(), draws[numDraws])) ++numDraws;
 		});
 
-	float aspectRatio = static_cast<float>(window->getSize().x) / static_cast<float>(window->getSize().y);
-	auto defMat = glm::ortho2d(0.f, aspectRatio, 1.f, 0.f);
-	window->draw(defMat);
-	window->drawSubObjects(defMat);
-	window->postDraw(defMat);
+	// the rest move, or are static but haven't had bounds yet. Slot order -- the batcher sorts them.
+	for (OpenGLModel* model : models) { // a copy, since moving it to the grid clears the slot
+		if (!model || !model->parent) continue;
 
-	// acquire a future object for the end of this frame
-	lastFrame = runOnRenderThreadAsync([]
+		mat3 modelMat = model->getModelMatrix();
+
+		// anything without bounds yet is drawn, so nothing pops in late
+		OpenGLBounds bounds;
+		if (model->getWorldBounds(modelMat, bounds)) {
+			++cullStats.numTested;
+
+			// this only clears its slot, so the loop can go on
+			if (model->isStatic()) moveModelToGrid(*model, bounds);
+
+			if (!bounds.intersects(viewBounds)) continue;
+		}
+
+		++cullStats.numVisible;
+		if (model->snapshot(modelMat, draws[numDraws])) ++numDraws;
+	}
+
+	cullStats.numCulled = cullStats.numModels - cullStats.numVisible;
+	lastCullStats = cullStats;
+
+	recordRenderCommand([this, view, draws, numDraws]
 		{
+			uploadCameraBlock(view);
+			batcher.draw(draws, numDraws);
 		});
+}
 
-	shouldExit = window->shouldClose();
+void OpenGLRenderer::uploadCameraBlock(const mat3& view)
+{
+	assert(isOnRenderThread());
 
-	return !shouldExit;
+	OpenGLCameraBlock block;
+	for (uint32 column = 0; column < 3; ++column) {
+		block.viewMat[column] = vec4(view[column], 0.f);
+	}
+
+	if (cameraBuffer == 0) glGenBuffers(1, &cameraBuffer);
+
+	// orphan last frame's storage so this doesn't wait for the draws still reading it
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+
+	stateCache.bindUniformBuffer(OpenGLMaterialSource::cameraBlockBinding, cameraBuffer);
+}
+
+void OpenGLRenderer::submitFrame()
+{
+	auto&& submitter = getThreadCommandList();
+
+	uint32 frameBuffer = recordingBuffer;
+	uint32 numLists;
+
+	// switch every list over to the next buffer at once. Nothing can be halfway through recording, and a
+	// list can't be registered in between.
+	{
+		std::lock_guard<std::mutex> listLock{commandListMutex};
+		numLists = numCommandLists;
+
+		for (uint32 i = 0; i < numLists; ++i) {
+			commandLists[i]->frameMutex.lock();
+		}
+
+		recordingBuffer = (frameBuffer + 1) % (frameLatency + 1);
+
+		for (uint32 i = 0; i < numLists; ++i) {
+			commandLists[i]->frameMutex.unlock();
+		}
+	}
+
+	++framesSubmitted;
+
+	gatherQueueStats(numLists);
+
+#if USE_PARALLEL_RENDERER
+	uint32 submitterIndex = submitter.index;
+
+	// small enough to not allocate in std::function
+	pushImmediateCommand([this, frameBuffer, numLists, submitterIndex]
+		{
+			// this frame's share of the textures that have finished decoding, so it can already draw them
+			textureLoader.uploadPending();
+
+			// the other threads' commands go first, in registration order. Drain their immediate queues
+			// before running their buffers so each thread's own commands stay in the order it sent them.
+			for (uint32 i = 0; i < numLists; ++i) {
+				if (i == submitterIndex) continue;
+
+				auto&& list = *commandLists[i];
+				list.queue.consume_all([](const std::function<void()>& fun)
+					{
+						fun();
+					});
+
+				list.frameCommands[frameBuffer].execute();
+				list.frameCommands[frameBuffer].reset();
+			}
+
+			// the submitting thread owns the frame -- its commands end with the buffer swap
+			auto&& buffer = commandLists[submitterIndex]->frameCommands[frameBuffer];
+			buffer.execute();
+			buffer.reset();
+
+			textureResidency.endFrame();
+			deletionQueue.endFrame();
+			stateCache.endFrame();
+
+			++framesCompleted;
+			frameWaiter.notify();
+		});
+#else
+	textureLoader.uploadPending();
+	submitter.frameCommands[frameBuffer].reset();
+	textureResidency.endFrame();
+	deletionQueue.endFrame();
+	stateCache.endFrame();
+	++framesCompleted;
+#endif
+}
+
+void OpenGLRenderer::retireGLObject(OpenGLObjectType type, GLuint name)
+{
+	if (name == 0) return;
+
+	runOnRenderThreadDetached([this, type, name]
+		{
+			deletionQueue.retire(type, name);
+		});
+}
+
+void OpenGLRenderer::gatherQueueStats(uint32 numLists)
+{
+	lastFrameQueueStats = RenderQueueFrameStats{};
+
+	for (uint32 i = 0; i < numLists; ++i) {
+		auto&& stats = commandLists[i]->queue.takeStats();
+
+		lastFrameQueueStats.peakDepth = std::max(lastFrameQueueStats.peakDepth, stats.peakDepth);
+		lastFrameQueueStats.numStalls += stats.numStalls;
+		lastFrameQueueStats.stallTime += stats.stallTime;
+	}
+
+	worstFrameQueueStats.peakDepth = std::max(worstFrameQueueStats.peakDepth, lastFrameQueueStats.peakDepth);
+	worstFrameQueueStats.numStalls = std::max(worstFrameQueueStats.numStalls, lastFrameQueueStats.numStalls);
+	worstFrameQueueStats.stallTime = std::max(worstFrameQueueStats.stallTime, lastFrameQueueStats.stallTime);
+}
+
+void OpenGLRenderer::releaseRetiredModels()
+{
+	auto completed = framesCompleted.load();
+
+	while (!retiredModels.empty() && retiredModels.front().first <= completed) {
+		delete retiredModels.front().second;
+		retiredModels.pop_front();
+	}
+
+	while (!retiredFrameResources.empty() && retiredFrameResources.front().first <= completed) {
+		retiredFrameResources.pop_front();
+	}
 }
 
 void OpenGLRenderer::showLoadingImage()
@@ -272,29 +819,15 @@ void OpenGLRenderer::showLoadingImage()
 			};
 
 			glGenVertexArrays(1, &vao);
-			glBindVertexArray(vao);
+			stateCache.bindVertexArray(vao);
 
 			glGenBuffers(1, &vbo);
 			glBindBuffer(GL_ARRAY_BUFFER, vbo);
 			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 4, vertLocs, GL_STATIC_DRAW);
 
-			glGenBuffers(1, &texCoordBuffer);
-			glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 4, texCoords, GL_STATIC_DRAW);
-
-			glGenBuffers(1, &ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uvec3) * 2, elems, GL_STATIC_DRAW);
-		});
-
-	program->setTexture(0, texture);
-
-	runOnRenderThreadSync([vbo, texCoordBuffer, ebo, vao, program]
-		{
-
-			program->use();
+			// bind location data to the element attrib array so it shows up in our shaders -- the location is
+			// zero (look in shader)
 			glEnableVertexAttribArray(0);
-			glBindBuffer(GL_ARRAY_BUFFER, vbo);
 			glVertexAttribPointer(0, // location 0 (see shader)
 				2,					 // two elements per vertex (x,y)
 				GL_FLOAT,			 // they are floats
@@ -303,11 +836,12 @@ void OpenGLRenderer::showLoadingImage()
 				nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
 				);
 
-			// bind UV data to the element attrib array so it shows up in our sahders -- the location is
-			// (look in
-			// shader)
-			glEnableVertexAttribArray(1);
+			glGenBuffers(1, &texCoordBuffer);
 			glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 4, texCoords, GL_STATIC_DRAW);
+
+			// same for the UVs, at location 1
+			glEnableVertexAttribArray(1);
 			glVertexAttribPointer(1, // location 1 (see shader)
 				2,					 // two elements per vertex (u,v)
 				GL_FLOAT,			 // they are floats
@@ -316,18 +850,41 @@ void OpenGLRenderer::showLoadingImage()
 				nullptr				 // use the GL_ARRAY_BUFFER instead of copying on the spot
 				);
 
-			// glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); // we don't have to do this bc its already bound
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+			glGenBuffers(1, &ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uvec3) * 2, elems, GL_STATIC_DRAW);
+		});
 
-			glDisableVertexAttribArray(0);
-			glDisableVertexAttribArray(1);
+	program->setTexture(0, texture);
 
-			// cleanup
-			glDeleteBuffers(1, &vbo);
-			glDeleteBuffers(1, &texCoordBuffer);
-			glDeleteBuffers(1, &ebo);
+	// drawn outside of a frame, so the textures don't go in a packet
+	runOnRenderThreadSync([this, vbo, texCoordBuffer, ebo, vao, program, textures = program->getTextureBindings()]
+		{
+			program->applyTextureBindings(textures);
+
+			// there's nothing else to show, so don't leave the image for a later frame
+			textureLoader.finishLoading();
+
+			program->use();
+
+			// there is no camera yet, so the image is drawn straight to the screen
+			uploadCameraBlock(mat3{});
+
+			// the boilerplate shader takes its model matrix per instance. Nothing is bound there, so it
+			// reads the attribute's current value instead.
+			glVertexAttrib3f(OpenGLMaterialSource::instanceModelMatLocation + 0, 1.f, 0.f, 0.f);
+			glVertexAttrib3f(OpenGLMaterialSource::instanceModelMatLocation + 1, 0.f, 1.f, 0.f);
+			glVertexAttrib3f(OpenGLMaterialSource::instanceModelMatLocation + 2, 0.f, 0.f, 1.f);
+
+			// the attributes and the element buffer were set up with the VAO
+			stateCache.bindVertexArray(vao);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 
-			glDeleteVertexArrays(1, &vao);
+			// cleanup
+			deletionQueue.retire(OpenGLObjectType::BUFFER, vbo);
+			deletionQueue.retire(OpenGLObjectType::BUFFER, texCoordBuffer);
+			deletionQueue.retire(OpenGLObjectType::BUFFER, ebo);
+			deletionQueue.retire(OpenGLObjectType::VERTEX_ARRAY, vao);
 		});
 
 	window->draw(mat3{}); // this does swap buffers and poll events
@@ -347,144 +904,93 @@ const CameraComponent& OpenGLRenderer::getCurrentCamera() const
 	return *currentCamera;
 }
 
-void OpenGLRenderer::drawDebugOutlinePolygon(vec2* verts, uint32 numVerts, Color color)
+void OpenGLRenderer::recordDebugDraw()
 {
+	auto&& lines = debugDraw.getLines();
+	auto&& triangles = debugDraw.getTriangles();
+	if (lines.empty() && triangles.empty()) return;
+
+	// copied into the frame, since the game thread starts on the next one's before this is drawn
+	auto lineVerts = allocateRenderData<OpenGLDebugVertex>(lines.size());
+	std::copy(lines.begin(), lines.end(), lineVerts);
+	auto triangleVerts = allocateRenderData<OpenGLDebugVertex>(triangles.size());
+	std::copy(triangles.begin(), triangles.end(), triangleVerts);
+
+	recordRenderCommand(
+		[this, lineVerts, numLines = lines.size(), triangleVerts, numTriangles = triangles.size()]
+		{
+			auto source = static_cast<OpenGLMaterialSource*>(debugDrawMaterial->getSource());
+			if (!source->isResident()) return;
 
-	assert(currentCamera.load());
-
-	debugDraw->use();
+			debugDrawMaterial->use();
+			debugDraw.draw(lineVerts, numLines, triangleVerts, numTriangles);
+		});
+}
 
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
+void OpenGLRenderer::recordText()
+{
+	// only copied over in frames with a UI pass, the render thread keeps them until the next
+	if (textRenderer.hasChanged()) {
+		auto&& batches = textRenderer.getBatches();
+
+		size_t numVertices = 0;
+		size_t numRanges = 0;
+		for (auto&& batch : batches) {
+			numVertices += batch.vertices.size();
+			if (!batch.vertices.empty()) ++numRanges;
+		}
+
+		auto vertices = allocateRenderData<OpenGLGlyphVertex>(numVertices);
+		auto ranges = allocateRenderData<OpenGLTextRenderer::Range>(numRanges);
+
+		size_t vertex = 0;
+		size_t range = 0;
+		for (auto&& batch : batches) {
+			if (batch.vertices.empty()) continue;
+
+			ranges[range++] = {batch.font, static_cast<GLint>(vertex), batch.vertices.size() / 4};
+			std::copy(batch.vertices.begin(), batch.vertices.end(), vertices + vertex);
+			vertex += batch.vertices.size();
+		}
+
+		recordRenderCommand([this, ranges, numRanges, vertices, numVertices]
+			{
+				textRenderer.upload(ranges, numRanges, vertices, numVertices);
+			});
+	}
 
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
+	recordRenderCommand([this]
+		{
+			textRenderer.draw();
+		});
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * numVerts, verts, GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_LINE_LOOP, 0, numVerts);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	textRenderer.endFrame();
 }
-void OpenGLRenderer::drawDebugLine(vec2* locs, uint32 numLocs, Color color)
+
+void OpenGLRenderer::drawDebugOutlinePolygon(vec2* verts, uint32 numVerts, Color color)
 {
+	assert(!isOnRenderThread());
 
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
+	debugDraw.addLineLoop(verts, numVerts, color);
+}
 
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
+void OpenGLRenderer::drawDebugLine(vec2* locs, uint32 numLocs, Color color)
+{
+	assert(!isOnRenderThread());
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * numLocs, locs, GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_LINE_STRIP, 0, numLocs);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	debugDraw.addLineStrip(locs, numLocs, color);
 }
+
 void OpenGLRenderer::drawDebugSolidPolygon(vec2* verts, uint32 numVerts, Color color)
 {
-	assert(currentCamera.load());
-
-	debugDraw->use();
-
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		.5f * (float)color.red / 255.f,
-		.5f * (float)color.green / 255.f,
-		.5f * (float)color.blue / 255.f,
-		.5f * (float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
+	assert(!isOnRenderThread());
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * numVerts, verts, GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, numVerts);
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glDrawArrays(GL_LINE_LOOP, 0, numVerts);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	debugDraw.addSolidPolygon(verts, numVerts, color);
 }
+
 void OpenGLRenderer::drawDebugOutlineCircle(vec2 center, float radius, Color color)
 {
-
-	assert(currentCamera.load());
+	assert(!isOnRenderThread());
 
 	using k_segments = boost::mpl::int_<16>;
 	const float k_increment = 2.0f * (float)M_PI / (float)k_segments::value;
@@ -495,48 +1001,12 @@ void OpenGLRenderer::drawDebugOutlineCircle(vec2 center, float radius, Color col
 		theta += k_increment;
 	}
 
-	debugDraw->use();
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
-
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * k_segments::value, &verts[0], GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_LINES, 0, k_segments::value);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	debugDraw.addLineLoop(verts.data(), k_segments::value, color);
 }
+
 void OpenGLRenderer::drawDebugSolidCircle(vec2 center, float radius, Color color)
 {
-
-	assert(currentCamera.load());
+	assert(!isOnRenderThread());
 
 	using k_segments = boost::mpl::int_<16>;
 	const float k_increment = 2.0f * (float)M_PI / (float)k_segments::value;
@@ -547,97 +1017,12 @@ void OpenGLRenderer::drawDebugSolidCircle(vec2 center, float radius, Color color
 		theta += k_increment;
 	}
 
-	debugDraw->use();
-
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		.5f * (float)color.red / 255.f,
-		.5f * (float)color.green / 255.f,
-		.5f * (float)color.blue / 255.f,
-		.5f * (float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
-
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * (uint32)k_segments::value, &verts[0], GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, (uint32)k_segments::value);
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glDrawArrays(GL_LINE_LOOP, 0, (uint32)k_segments::value);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	debugDraw.addSolidPolygon(verts.data(), k_segments::value, color);
 }
+
 void OpenGLRenderer::drawDebugSegment(vec2 p1, vec2 p2, Color color)
 {
+	assert(!isOnRenderThread());
 
-	assert(currentCamera.load());
-
-	debugDraw->use();
-
-	GLuint program = *static_cast<OpenGLMaterialSource&>(*debugDraw->getSource());
-
-	glUniform4f(glGetUniformLocation(program, "color"),
-		(float)color.red / 255.f,
-		(float)color.green / 255.f,
-		(float)color.blue / 255.f,
-		(float)color.alpha / 255.f);
-	glUniformMatrix3fv(
-		glGetUniformLocation(program, "MVPmat"), 1, GL_FALSE, &currentCamera.load()->getViewMat()[0][0]);
-
-	auto locs = std::array<vec2, 2>();
-	locs[0] = p1;
-	locs[1] = p2;
-
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	GLuint buff;
-	glGenBuffers(1, &buff);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 2, &locs[0], GL_STATIC_DRAW);
-
-	// bind location data to the element attrib array so it shows up in our shaders -- the location is zero
-	// (look in shader)
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, buff);
-	glVertexAttribPointer(0, // location 0 (see shader)
-		2,					 // two elements per vertex (x,y)
-		GL_FLOAT,			 // they are floats
-		GL_FALSE,			 // not normalized
-		sizeof(float) * 2,   // the next element is 2 floats later
-		nullptr				 // dont copy -- use the GL_ARRAY_BUFFER instead
-		);
-
-	glDrawArrays(GL_LINES, 0, 2);
-
-	glDisableVertexAttribArray(0);
-
-	glDeleteBuffers(1, &buff);
-	glDeleteVertexArrays(1, &vao);
+	debugDraw.addSegment(p1, p2, color);
 }
@@ -2,7 +2,11 @@
 #include <Renderer.h>
 #include <Cacher.h>
 
+#include <array>
+#include <deque>
 #include <list>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 #include <thread>
@@ -14,6 +18,20 @@
 
 #include <call_from_tuple.h>
 
+#include "OpenGLRenderQueueWaiter.h"
+#include "OpenGLBatcher.h"
+#include "OpenGLCommandBuffer.h"
+#include "OpenGLCullingGrid.h"
+#include "OpenGLDebugDraw.h"
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLPresenter.h"
+#include "OpenGLProgramCache.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLTextRenderer.h"
+#include "OpenGLTextureLoader.h"
+#include "OpenGLTextureResidency.h"
+#include "OpenGLThreadCommandList.h"
+
 #include <boost/lockfree/spsc_queue.hpp>
 
 #define USE_PARALLEL_RENDERER 1
@@ -31,6 +49,12 @@ class OpenGLFont;
 
 class OpenGLRenderer;
 
+// What the Camera uniform block holds, laid out std140 -- a mat3 there is three vec4 columns.
+struct OpenGLCameraBlock
+{
+	vec4 viewMat[3];
+};
+
 template <typename T>
 class RenderThreadOnly
 {
@@ -60,17 +84,19 @@ private:
 class OpenGLRenderer : public Renderer
 {
 
-	friend class OpenGLTextBoxWidget;
+	friend class OpenGLModel;
 
 	struct RenderThread
 	{
-		RenderThread(std::thread&& thread)
+		RenderThread(OpenGLRenderQueueWaiter& waiter, std::thread&& thread)
 			: isInLoop(true)
+			, waiter(waiter)
 			, thread(std::move(thread))
 		{
 		}
-		RenderThread()
+		explicit RenderThread(OpenGLRenderQueueWaiter& waiter)
 			: isInLoop(true)
+			, waiter(waiter)
 		{
 		}
 
@@ -87,12 +113,14 @@ class OpenGLRenderer : public Renderer
 		~RenderThread()
 		{
 			isInLoop = false;
+			waiter.notify(); // it might be parked
 			if (thread.joinable()) thread.join();
 		}
 
 		std::atomic<bool> isInLoop;
 
 	private:
+		OpenGLRenderQueueWaiter& waiter;
 		std::thread thread;
 	};
 
@@ -114,6 +142,7 @@ public:
 	virtual Texture* getTexture(const path_t& name) override;
 	virtual MaterialSource* getMaterialSource(const path_t& name) override;
 	virtual std::unique_ptr<TextureLibrary> newTextureLibrary() override;
+	virtual std::unique_ptr<Texture> newTileIndexTexture(uvec2 size, const uint16* indices) override;
 	virtual std::unique_ptr<MaterialInstance> newMaterialInstance(MaterialSource* source) override;
 	virtual std::shared_ptr<ModelData> newModelData(const std::string& name) override;
 	virtual std::unique_ptr<ModelData> newModelData() override;
@@ -138,9 +167,28 @@ public:
 	virtual void drawDebugSolidCircle(vec2 center, float radius, Color color) override;
 	virtual void drawDebugSegment(vec2 p1, vec2 p2, Color color) override;
 
+	/// <summary> Records a command into the calling thread's command buffer for this frame. It runs on the
+	/// render thread when the frame is submitted, in recording order. Doesn't allocate once the buffers have
+	/// warmed up, so this is what per-frame work should use. Runs immediately if called from the render
+	/// thread. </summary>
+	template <typename Function>
+	inline void recordRenderCommand(Function&& func);
+
+	/// <summary> Gets scratch memory in the calling thread's command buffer for data a recorded command
+	/// needs. Valid until the frame after the current one has been rendered. </summary>
+	template <typename T>
+	inline T* allocateRenderData(size_t count);
+
+	/// <summary> Runs func on the render thread without waiting for it or handing back a future. It stays in
+	/// order with the calling thread's other runOnRenderThread* calls. Runs immediately if called from the
+	/// render thread. </summary>
+	template <typename Function>
+	inline void runOnRenderThreadDetached(Function&& func);
+
 	template <typename Function, typename... Args>
 	inline auto runOnRenderThreadSync(Function&& func, Args&&... args);
 
+	// Opt-in futures API: allocates a packaged_task per call, so keep it out of per-frame code.
 	// the futures from this function should NEVER be used in the render thread -- could produce deadlock
 	template <typename Function, typename... Args>
 	inline auto runOnRenderThreadAsync(Function&& func, Args&&... args);
@@ -162,6 +210,105 @@ public:
 		}
 	}
 
+	/// <summary> Hands a GL name to the deletion queue without waiting. It's deleted once the GPU is done
+	/// with the frames that might still use it. Only for names the calling thread can already see -- ones
+	/// the render thread is still filling in have to be retired from there, through getDeletionQueue.
+	/// </summary>
+	void retireGLObject(OpenGLObjectType type, GLuint name);
+
+	/// <summary> Holds on to something packets point at until the frames already submitted are done -- a
+	/// model's old material or model data, or a texture a material let go of. Game thread only. </summary>
+	void retireFrameResource(std::shared_ptr<void> resource);
+
+	/// <summary> Render thread only. </summary>
+	OpenGLDeletionQueue& getDeletionQueue()
+	{
+		assert(isOnRenderThread());
+		return deletionQueue;
+	}
+
+	/// <summary> Render thread only. Binds programs, VAOs and textures and sets uniforms without repeating
+	/// what is already set. </summary>
+	OpenGLStateCache& getStateCache()
+	{
+		assert(isOnRenderThread());
+		return stateCache;
+	}
+
+	/// <summary> Decodes textures in the background and uploads them a few a frame. Loading is safe from any
+	/// thread, the rest is render thread only. </summary>
+	OpenGLTextureLoader& getTextureLoader() { return textureLoader; }
+
+	/// <summary> Keeps texture memory under Renderer.textureBudget. Render thread only. </summary>
+	OpenGLTextureResidency& getTextureResidency()
+	{
+		assert(isOnRenderThread());
+		return textureResidency;
+	}
+
+	/// <summary> Loads and stores program binaries. Reading files is safe from any thread, the rest is render
+	/// thread only. </summary>
+	OpenGLProgramCache& getProgramCache() { return programCache; }
+
+	/// <summary> Where the scene is drawn and how it is shown. Its settings are safe from any thread, the
+	/// rest is render thread only. </summary>
+	OpenGLPresenter& getPresenter() { return presenter; }
+
+	/// <summary> How many frames the game thread may get ahead of the render thread. </summary>
+	uint32 getFrameLatency() const { return frameLatency; }
+
+	/// <summary> How many frames have been recorded, which is also the number of the one being recorded now.
+	/// Game thread only. </summary>
+	uint64 getFramesSubmitted() const { return framesSubmitted; }
+
+	/// <summary> Gets how often the render thread went idle and how long it spent there. </summary>
+	RenderQueueWaitStats getRenderQueueWaitStats() const { return queueWaiter.getStats(); }
+
+	/// <summary> Gets how many commands each list has had submitted to it, in registration order. A list is
+	/// used by one thread at a time, but goes to another once that thread exits. </summary>
+	std::vector<RenderSubmissionStats> getSubmissionStats() const;
+
+	/// <summary> Gets how many models the last rendered frame drew, how many draw calls that took, and how
+	/// many state changes sorting saved. </summary>
+	RenderBatchStats getBatchStats() const { return batcher.getStats(); }
+
+	/// <summary> Gets how many models the last recorded frame left out because the camera couldn't see them.
+	/// Game thread only. </summary>
+	const RenderCullStats& getCullStats() const { return lastCullStats; }
+
+	/// <summary> Gets how many debug shapes the last recorded frame drew and how many were off screen. Game
+	/// thread only. </summary>
+	const RenderDebugDrawStats& getDebugDrawStats() const { return debugDraw.getStats(); }
+
+	/// <summary> Collects the UI's text, a batch per font. Game thread only. </summary>
+	OpenGLTextRenderer& getTextRenderer()
+	{
+		assert(!isOnRenderThread());
+		return textRenderer;
+	}
+
+	/// <summary> Gets how many text boxes and glyphs the UI has, in how many draw calls, and how many times
+	/// it has been drawn again because something changed. Game thread only. </summary>
+	const RenderTextStats& getTextStats() const { return textRenderer.getStats(); }
+
+	/// <summary> Gets how many program, VAO, texture and uniform calls the last rendered frame made and how
+	/// many it skipped because they were already set. </summary>
+	OpenGLStateStats getStateStats() const { return stateCache.getStats(); }
+
+	/// <summary> Gets how many textures have been loaded and how many are waiting to be uploaded. </summary>
+	OpenGLTextureLoadStats getTextureLoadStats() const { return textureLoader.getStats(); }
+
+	/// <summary> Gets how much texture memory is in use against the budget, and how much has been evicted and
+	/// loaded again, as of the last rendered frame. </summary>
+	OpenGLResidencyStats getTextureResidencyStats() const { return textureResidency.getStats(); }
+
+	/// <summary> Gets how many programs came from binaries and how much compiling that saved. </summary>
+	OpenGLProgramCacheStats getProgramCacheStats() const { return programCache.getStats(); }
+
+	/// <summary> Gets how deep the queues got and how long producers stalled during the last frame. Game
+	/// thread only. </summary>
+	const RenderQueueFrameStats& getLastFrameQueueStats() const { return lastFrameQueueStats; }
+
 	inline bool isOnRenderThread()
 	{
 #if USE_PARALLEL_RENDERER
@@ -175,30 +322,157 @@ private:
 	void initRenderer();
 	void renderLoop();
 
-	boost::lockfree::spsc_queue<std::function<void()>> queue;
+	/// <summary> Gets the calling thread's command list, registering it the first time. A list whose thread
+	/// has exited is handed out again before a new one is made. </summary>
+	OpenGLThreadCommandList& getThreadCommandList();
+
+	/// <summary> Hands list back for another thread to use. Called as its thread exits. </summary>
+	void releaseThreadCommandList(OpenGLThreadCommandList& list);
+
+	struct ThreadCommandListCache; // the calling thread's list, and which renderer it is from
+	void pushImmediateCommand(std::function<void()>&& func);
+	bool hasImmediateCommands() const;
+
+	/// <summary> Fills the Camera block with view and leaves it bound for every program. Render thread
+	/// only. </summary>
+	void uploadCameraBlock(const mat3& view);
+
+	void addModelSlot(OpenGLModel& model);
+	void removeModelSlot(OpenGLModel& model);
+
+	/// <summary> Takes a static model out of its slot and puts it in the culling grid. </summary>
+	void moveModelToGrid(OpenGLModel& model, const OpenGLBounds& bounds);
+
+	/// <summary> Gives a model in the culling grid its slot back, so its bounds are looked at again.
+	/// </summary>
+	void removeModelFromGrid(OpenGLModel& model);
+
+	void waitForFrameSlot();
+	void waitForAllFrames();
+	void recordFramePacket();
+
+	/// <summary> Sends the frame's debug shapes to the render thread as one command. </summary>
+	void recordDebugDraw();
+
+	/// <summary> Sends each font's glyphs to the render thread as one command. </summary>
+	void recordText();
+
+	void submitFrame();
+	void gatherQueueStats(uint32 numLists);
+	void releaseRetiredModels();
+
+	static const uint32 maxFrameLatency = OpenGLThreadCommandList::numFrameBuffers - 1;
+	static const uint32 maxCommandLists = 64;
+
+	OpenGLRenderQueueWaiter queueWaiter; // must outlive renderThread
+
+	// one per thread that is submitting -- these must outlive renderThread too
+	std::array<std::unique_ptr<OpenGLThreadCommandList>, maxCommandLists> commandLists;
+	std::atomic<uint32> numCommandLists;
+	std::mutex commandListMutex; // taken to register or release a list and to switch frames
+	std::vector<uint32> freeCommandLists; // whose threads have exited
+
+	// different for every renderer made, so a thread's cached list can't be mistaken for one from a renderer
+	// that used to be at the same address
+	const uint64 generation;
+
+	size_t queueHighWaterMark;
+	size_t queueLowWaterMark;
+
+	uint32 frameLatency;
+	std::atomic<uint32> recordingBuffer; // the same in every list
+	uint64 framesSubmitted;
+	std::atomic<uint64> framesCompleted;
+	OpenGLRenderQueueWaiter frameWaiter;
+
+	OpenGLStateCache stateCache;	   // render thread only, and must outlive renderThread
+	OpenGLDeletionQueue deletionQueue; // same for these
+	OpenGLBatcher batcher;
+	OpenGLProgramCache programCache;
+	OpenGLTextureLoader textureLoader;
+	OpenGLTextureResidency textureResidency;
+	OpenGLDebugDraw debugDraw; // shapes on the game thread, the stream buffer on the render thread
+	OpenGLTextRenderer textRenderer; // same for glyphs
+	OpenGLPresenter presenter;
+	GLuint cameraBuffer; // render thread only
+
 	RenderThread renderThread;
 
 	std::unique_ptr<OpenGLWindowWidget> window;
-	std::unique_ptr<OpenGLMaterialInstance> debugDraw;
+	std::unique_ptr<OpenGLMaterialInstance> debugDrawMaterial;
 
 	// then delete our atomics
 	std::atomic<CameraComponent*> currentCamera;
-	std::future<void> lastFrame;
 	std::atomic<bool> shouldExit;
 
 	// delete our caches and models first
-	RenderThreadOnly<std::map<uint8, std::list<OpenGLModel*>>> models;
-	RenderThreadOnly<std::list<OpenGLTextBoxWidget*>> textBoxes;
+	// game thread only -- the render thread gets packets. A model keeps its slot until it is removed or put
+	// in the grid, and free slots are handed out again. The render thread sorts, so these can be in any
+	// order.
+	std::vector<OpenGLModel*> models;
+	std::vector<uint32> freeModelSlots;
+	OpenGLCullingGrid cullingGrid; // static models with bounds
+	RenderCullStats lastCullStats;
 
 	StrongCacher<path_t, OpenGLTexture> textures;
 	StrongCacher<path_t, OpenGLFont> fonts;
 	StrongCacher<path_t, OpenGLMaterialSource> matSources;
 	WeakCacher<std::string, OpenGLModelData> modelDataCache;
 
-	boost::lockfree::spsc_queue<OpenGLModel*> modelsToDelete;
-	boost::lockfree::spsc_queue<OpenGLModel*> modelsToAdd;
+	RenderQueueFrameStats lastFrameQueueStats;
+	RenderQueueFrameStats worstFrameQueueStats; // the worst of each over every frame so far
+
+	// models that have been removed but may still be in a packet, with the frame they were removed in
+	std::deque<std::pair<uint64, OpenGLModel*>> retiredModels;
+	std::deque<std::pair<uint64, std::shared_ptr<void>>> retiredFrameResources; // the same, for what they drew with
 };
 
+template <typename Function>
+inline void OpenGLRenderer::recordRenderCommand(Function&& func)
+{
+#if USE_PARALLEL_RENDERER
+	if (isOnRenderThread()) {
+		func();
+		return;
+	}
+
+	auto&& list = getThreadCommandList();
+	{
+		std::lock_guard<std::mutex> lock{list.frameMutex};
+		list.frameCommands[recordingBuffer].record(std::forward<Function>(func));
+	}
+	++list.numRecordedCommands;
+#else
+	func();
+#endif
+}
+
+template <typename T>
+inline T* OpenGLRenderer::allocateRenderData(size_t count)
+{
+	assert(!isOnRenderThread());
+
+	auto&& list = getThreadCommandList();
+
+	std::lock_guard<std::mutex> lock{list.frameMutex};
+	return list.frameCommands[recordingBuffer].allocate<T>(count);
+}
+
+template <typename Function>
+inline void OpenGLRenderer::runOnRenderThreadDetached(Function&& func)
+{
+#if USE_PARALLEL_RENDERER
+	if (isOnRenderThread()) {
+		func();
+		return;
+	}
+
+	pushImmediateCommand(std::forward<Function>(func));
+#else
+	func();
+#endif
+}
+
 template <typename Function, typename... Args>
 inline auto OpenGLRenderer::runOnRenderThreadSync(Function&& func, Args&&... args)
 {
@@ -211,7 +485,7 @@ inline auto OpenGLRenderer::runOnRenderThreadSync(Function&& func, Args&&... arg
 
 	std::packaged_task<retType(Args && ...)> task{func};
 
-	queue.push([&task, &args...]
+	pushImmediateCommand([&task, &args...]
 		{
 			task(std::forward<Args>(args)...);
 		});
@@ -236,7 +510,8 @@ inline auto OpenGLRenderer::runOnRenderThreadAsync(Function&& func, Args&&... ar
 
 	auto ret = task->get_future(); // cache it because it will be moved from.
 
-	queue.push([ pack = std::move(task), args = std::make_tuple(std::forward<Args>(args)...) ]() mutable
+	pushImmediateCommand(
+		[ pack = std::move(task), args = std::make_tuple(std::forward<Args>(args)...) ]() mutable
 		{
 			callWithTuple(*pack, args);
 		});
@@ -0,0 +1,259 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLRenderQueueWaiter.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+struct OpenGLQueueStats
+{
+	size_t peakDepth;					// most items waiting at once
+	uint64 numStalls;					// times the producer hit the high water mark
+	std::chrono::nanoseconds stallTime; // time the producer spent waiting to get back under the low one
+};
+
+// A single producer, single consumer queue made of fixed size segments linked together. It grows instead of
+// dropping items when it fills up. Consumed segments go back to the producer, so once it has grown to fit
+// the workload it stops allocating.
+//
+// If a high water mark is set, push blocks once that many items are waiting, until the consumer has
+// brought it down to the low water mark.
+template <typename T, size_t SegmentSize = 256>
+class OpenGLSegmentedQueue
+{
+public:
+	explicit OpenGLSegmentedQueue(size_t highWaterMark = 0, size_t lowWaterMark = 0);
+	~OpenGLSegmentedQueue();
+
+	OpenGLSegmentedQueue(const OpenGLSegmentedQueue& other) = delete;
+	OpenGLSegmentedQueue& operator=(const OpenGLSegmentedQueue& other) = delete;
+
+	/// <summary> Sets when push blocks. A high water mark of 0 means never. </summary>
+	void setWaterMarks(size_t newHighWaterMark, size_t newLowWaterMark);
+
+	/// <summary> Producer only. Never drops the item, but may block if a high water mark is set. </summary>
+	template <typename U>
+	inline void push(U&& item);
+
+	/// <summary> Consumer only. Calls func on every item that is waiting, in order. </summary>
+	///
+	/// <returns> The number of items consumed. </returns>
+	template <typename Functor>
+	inline size_t consume_all(Functor&& func);
+
+	/// <summary> How many items are waiting. Exact from the consumer, a snapshot from anywhere else.
+	/// </summary>
+	size_t read_available() const
+	{
+		// from a third thread the consumer's pop can show up before the push it took, so popped can be ahead
+		size_t popped = numPopped.load();
+		size_t pushed = numPushed.load();
+		return pushed >= popped ? pushed - popped : 0;
+	}
+
+	/// <summary> Gets the stats since the last call and starts over. </summary>
+	OpenGLQueueStats takeStats();
+
+private:
+	struct Segment
+	{
+		Segment()
+			: committed(0)
+			, next(nullptr)
+		{
+		}
+
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type items[SegmentSize];
+		std::atomic<size_t> committed; // items written -- only the producer writes this
+		std::atomic<Segment*> next;
+	};
+
+	Segment* acquireSegment();
+	void recycleSegment(Segment* segment);
+
+	void waitForSpace();
+
+	// producer side
+	Segment* tail;
+
+	// consumer side
+	Segment* head;
+	size_t headIndex;
+
+	// consumed segments on their way back to the producer
+	boost::lockfree::spsc_queue<Segment*, boost::lockfree::capacity<16>> freeSegments;
+
+	std::atomic<size_t> numPushed;
+	std::atomic<size_t> numPopped;
+
+	size_t highWaterMark;
+	size_t lowWaterMark;
+	OpenGLRenderQueueWaiter spaceWaiter;
+
+	std::atomic<size_t> peakDepth;
+	std::atomic<uint64> numStalls;
+	std::atomic<int64> stallNanoseconds;
+};
+
+template <typename T, size_t SegmentSize>
+OpenGLSegmentedQueue<T, SegmentSize>::OpenGLSegmentedQueue(size_t highWaterMark, size_t lowWaterMark)
+	: tail(new Segment)
+	, headIndex(0)
+	, numPushed(0)
+	, numPopped(0)
+	, highWaterMark(highWaterMark)
+	, lowWaterMark(lowWaterMark)
+	, spaceWaiter(RenderQueueWaitStrategy::ADAPTIVE, 0, 16) // the producer has nothing better to do
+	, peakDepth(0)
+	, numStalls(0)
+	, stallNanoseconds(0)
+{
+	head = tail;
+}
+
+template <typename T, size_t SegmentSize>
+OpenGLSegmentedQueue<T, SegmentSize>::~OpenGLSegmentedQueue()
+{
+	// destroy anything that was never consumed
+	consume_all([](T&)
+		{
+		});
+
+	delete head;
+
+	freeSegments.consume_all([](Segment* segment)
+		{
+			delete segment;
+		});
+}
+
+template <typename T, size_t SegmentSize>
+void OpenGLSegmentedQueue<T, SegmentSize>::setWaterMarks(size_t newHighWaterMark, size_t newLowWaterMark)
+{
+	assert(newLowWaterMark <= newHighWaterMark);
+
+	highWaterMark = newHighWaterMark;
+	lowWaterMark = newLowWaterMark;
+}
+
+template <typename T, size_t SegmentSize>
+template <typename U>
+inline void OpenGLSegmentedQueue<T, SegmentSize>::push(U&& item)
+{
+	if (highWaterMark != 0 && read_available() >= highWaterMark) waitForSpace();
+
+	size_t index = tail->committed.load(std::memory_order_relaxed);
+	if (index == SegmentSize) {
+		Segment* newTail = acquireSegment();
+		tail->next.store(newTail, std::memory_order_release);
+
+		tail = newTail;
+		index = 0;
+	}
+
+	new (&tail->items[index]) T(std::forward<U>(item));
+	tail->committed.store(index + 1, std::memory_order_release);
+
+	// the consumer can't pop what this thread hasn't pushed, so this can't go below 0
+	size_t depth = numPushed.fetch_add(1) + 1 - numPopped.load();
+
+	size_t peak = peakDepth.load();
+	while (depth > peak && !peakDepth.compare_exchange_weak(peak, depth))
+		;
+}
+
+template <typename T, size_t SegmentSize>
+template <typename Functor>
+inline size_t OpenGLSegmentedQueue<T, SegmentSize>::consume_all(Functor&& func)
+{
+	size_t count = 0;
+
+	while (true) {
+		if (headIndex < head->committed.load(std::memory_order_acquire)) {
+			T* item = reinterpret_cast<T*>(&head->items[headIndex]);
+
+			func(*item);
+			item->~T();
+
+			++headIndex;
+			++count;
+			++numPopped;
+
+			continue;
+		}
+
+		// move on to the next segment if this one is done and the producer has started another
+		if (headIndex == SegmentSize) {
+			Segment* next = head->next.load(std::memory_order_acquire);
+			if (next) {
+				recycleSegment(head);
+
+				head = next;
+				headIndex = 0;
+
+				continue;
+			}
+		}
+
+		break;
+	}
+
+	if (count != 0) spaceWaiter.notify();
+
+	return count;
+}
+
+template <typename T, size_t SegmentSize>
+OpenGLQueueStats OpenGLSegmentedQueue<T, SegmentSize>::takeStats()
+{
+	OpenGLQueueStats ret;
+
+	ret.peakDepth = peakDepth.exchange(read_available());
+	ret.numStalls = numStalls.exchange(0);
+	ret.stallTime = std::chrono::nanoseconds(stallNanoseconds.exchange(0));
+
+	return ret;
+}
+
+template <typename T, size_t SegmentSize>
+typename OpenGLSegmentedQueue<T, SegmentSize>::Segment* OpenGLSegmentedQueue<T, SegmentSize>::acquireSegment()
+{
+	Segment* ret;
+	if (freeSegments.pop(ret)) {
+		ret->committed.store(0, std::memory_order_relaxed);
+		ret->next.store(nullptr, std::memory_order_relaxed);
+
+		return ret;
+	}
+
+	return new Segment;
+}
+
+template <typename T, size_t SegmentSize>
+void OpenGLSegmentedQueue<T, SegmentSize>::recycleSegment(Segment* segment)
+{
+	// keep a few around for the producer, the rest can go
+	if (!freeSegments.push(segment)) delete segment;
+}
+
+template <typename T, size_t SegmentSize>
+void OpenGLSegmentedQueue<T, SegmentSize>::waitForSpace()
+{
+	++numStalls;
+
+	auto stallStart = std::chrono::steady_clock::now();
+
+	spaceWaiter.wait([this]
+		{
+			return read_available() <= lowWaterMark;
+		});
+
+	stallNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - stallStart).count();
+}
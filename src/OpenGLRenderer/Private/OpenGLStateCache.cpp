@@ -0,0 +1,188 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLStateCache.h"
+
+#include <cstring>
+
+OpenGLStateCache::OpenGLStateCache()
+	: program(unknown)
+	, vertexArray(unknown)
+	, activeUnit(maxTextureUnits)
+	, programUniforms(nullptr)
+	, frameStats{}
+	, lastStats{}
+{
+	textures.fill(unknown);
+	textureArrays.fill(unknown);
+	uniformBuffers.fill(unknown);
+}
+
+void OpenGLStateCache::useProgram(GLuint newProgram)
+{
+	if (newProgram == program) {
+		++frameStats.programs.elided;
+		return;
+	}
+
+	glUseProgram(newProgram);
+	++frameStats.programs.issued;
+
+	program = newProgram;
+	programUniforms = newProgram != 0 ? &uniforms[newProgram] : nullptr;
+}
+
+void OpenGLStateCache::bindVertexArray(GLuint newVertexArray)
+{
+	if (newVertexArray == vertexArray) {
+		++frameStats.vertexArrays.elided;
+		return;
+	}
+
+	glBindVertexArray(newVertexArray);
+	++frameStats.vertexArrays.issued;
+
+	vertexArray = newVertexArray;
+}
+
+void OpenGLStateCache::bindTexture(uint32 unit, GLuint texture)
+{
+	assert(unit < maxTextureUnits);
+
+	if (textures[unit] == texture) {
+		++frameStats.textures.elided;
+		return;
+	}
+
+	activateUnit(unit);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	++frameStats.textures.issued;
+
+	textures[unit] = texture;
+}
+
+void OpenGLStateCache::bindTextureArray(uint32 unit, GLuint texture)
+{
+	assert(unit < maxTextureUnits);
+
+	if (textureArrays[unit] == texture) {
+		++frameStats.textures.elided;
+		return;
+	}
+
+	activateUnit(unit);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	++frameStats.textures.issued;
+
+	textureArrays[unit] = texture;
+}
+
+void OpenGLStateCache::bindUniformBuffer(uint32 binding, GLuint buffer)
+{
+	assert(binding < maxUniformBufferBindings);
+
+	if (uniformBuffers[binding] == buffer) {
+		++frameStats.uniformBuffers.elided;
+		return;
+	}
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	++frameStats.uniformBuffers.issued;
+
+	uniformBuffers[binding] = buffer;
+}
+
+bool OpenGLStateCache::shouldSetUniform(GLint location, const void* data, size_t size)
+{
+	if (location == -1 || !programUniforms) {
+		++frameStats.uniforms.issued;
+		return true;
+	}
+
+	if (size > maxUniformSize) {
+		programUniforms->erase(location);
+
+		++frameStats.uniforms.issued;
+		return true;
+	}
+
+	auto&& value = (*programUniforms)[location];
+	if (value.size == size && std::memcmp(value.bytes.data(), data, size) == 0) {
+		++frameStats.uniforms.elided;
+		return false;
+	}
+
+	value.size = size;
+	std::memcpy(value.bytes.data(), data, size);
+
+	++frameStats.uniforms.issued;
+	return true;
+}
+
+void OpenGLStateCache::invalidateTextures()
+{
+	activeUnit = maxTextureUnits;
+	textures.fill(unknown);
+	textureArrays.fill(unknown);
+}
+
+void OpenGLStateCache::onDeleted(OpenGLObjectType type, const GLuint* names, size_t count)
+{
+	// a deleted name can be handed out again, and must not look bound when it is
+	for (size_t i = 0; i < count; ++i) {
+		GLuint name = names[i];
+
+		switch (type)
+		{
+		case OpenGLObjectType::BUFFER:
+			for (auto&& buffer : uniformBuffers) {
+				if (buffer == name) buffer = unknown;
+			}
+			break;
+		case OpenGLObjectType::VERTEX_ARRAY:
+			if (vertexArray == name) vertexArray = unknown;
+			break;
+		case OpenGLObjectType::TEXTURE:
+			for (auto&& texture : textures) {
+				if (texture == name) texture = unknown;
+			}
+			for (auto&& texture : textureArrays) {
+				if (texture == name) texture = unknown;
+			}
+			break;
+		case OpenGLObjectType::PROGRAM:
+			if (program == name) {
+				program = unknown;
+				programUniforms = nullptr;
+			}
+			uniforms.erase(name);
+			break;
+		default: break;
+		}
+	}
+}
+
+void OpenGLStateCache::endFrame()
+{
+	std::lock_guard<std::mutex> lock{statsMutex};
+
+	lastStats = frameStats;
+	frameStats = OpenGLStateStats{};
+}
+
+OpenGLStateStats OpenGLStateCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock{statsMutex};
+	return lastStats;
+}
+
+void OpenGLStateCache::activateUnit(uint32 unit)
+{
+	if (activeUnit == unit) return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	++frameStats.textures.issued;
+
+	activeUnit = unit;
+}
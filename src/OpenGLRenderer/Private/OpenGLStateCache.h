@@ -0,0 +1,105 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLDeletionQueue.h"
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+struct OpenGLStateCounts
+{
+	uint64 issued; // calls that went to the driver
+	uint64 elided; // calls that would have set what was already there
+};
+
+struct OpenGLStateStats
+{
+	OpenGLStateCounts programs;
+	OpenGLStateCounts vertexArrays;
+	OpenGLStateCounts textures; // 2D and array, active unit switches included
+	OpenGLStateCounts uniformBuffers;
+	OpenGLStateCounts uniforms;
+};
+
+// Remembers what the render thread last bound -- program, VAO, the 2D and array texture on each unit, the
+// buffer on each uniform block binding and every uniform value per program -- so setting it again can be
+// skipped.
+// Everything that binds those has to go through here, or call one of the invalidate functions after, or this
+// goes stale. Render thread only, unless noted.
+class OpenGLStateCache
+{
+public:
+	static const uint32 maxTextureUnits = 32;
+	static const uint32 maxUniformBufferBindings = 16;
+
+	OpenGLStateCache();
+
+	OpenGLStateCache(const OpenGLStateCache& other) = delete;
+	OpenGLStateCache& operator=(const OpenGLStateCache& other) = delete;
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+
+	/// <summary> Binds texture to GL_TEXTURE_2D on unit, switching the active unit only if it has to.
+	/// </summary>
+	void bindTexture(uint32 unit, GLuint texture);
+
+	/// <summary> Binds texture to GL_TEXTURE_2D_ARRAY on unit. Units keep a binding for each target, so this
+	/// doesn't unbind the 2D texture there. </summary>
+	void bindTextureArray(uint32 unit, GLuint texture);
+
+	/// <summary> glBindBufferBase on GL_UNIFORM_BUFFER. </summary>
+	void bindUniformBuffer(uint32 binding, GLuint buffer);
+
+	/// <summary> Checks a uniform of the program in use against the value it was last given, and remembers
+	/// the new one. Values bigger than a mat4 aren't remembered, so they are always set. </summary>
+	///
+	/// <returns> If the uniform has to be set. </returns>
+	bool shouldSetUniform(GLint location, const void* data, size_t size);
+
+	/// <summary> Forgets the texture bindings and the active unit. For code that binds textures itself,
+	/// like SOIL. </summary>
+	void invalidateTextures();
+
+	/// <summary> Forgets everything it knows about names that were just deleted. Called by the deletion
+	/// queue. </summary>
+	void onDeleted(OpenGLObjectType type, const GLuint* names, size_t count);
+
+	/// <summary> Publishes this frame's counts for getStats and starts over. </summary>
+	void endFrame();
+
+	/// <summary> Gets the last finished frame's counts. Safe from any thread. </summary>
+	OpenGLStateStats getStats() const;
+
+private:
+	// no GL name is this, so it never matches what is asked for
+	static const GLuint unknown = ~GLuint(0);
+
+	static const size_t maxUniformSize = sizeof(float) * 16;
+
+	/// <summary> Makes unit the active one, if it isn't already. </summary>
+	void activateUnit(uint32 unit);
+
+	struct UniformValue
+	{
+		size_t size;
+		std::array<char, maxUniformSize> bytes;
+	};
+
+	GLuint program;
+	GLuint vertexArray;
+	uint32 activeUnit;
+	std::array<GLuint, maxTextureUnits> textures;
+	std::array<GLuint, maxTextureUnits> textureArrays;
+	std::array<GLuint, maxUniformBufferBindings> uniformBuffers;
+
+	// by program, then location
+	std::unordered_map<GLuint, std::unordered_map<GLint, UniformValue>> uniforms;
+	std::unordered_map<GLint, UniformValue>* programUniforms; // the one for program, so lookups skip a level
+
+	OpenGLStateStats frameStats;
+
+	mutable std::mutex statsMutex;
+	OpenGLStateStats lastStats;
+};
@@ -0,0 +1,57 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLStreamBuffer.h"
+
+#include "OpenGLDeletionQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+OpenGLStreamBuffer::OpenGLStreamBuffer()
+	: buffer(0)
+	, capacity(0)
+	, head(0)
+{
+}
+
+void OpenGLStreamBuffer::bind()
+{
+	if (buffer == 0) glGenBuffers(1, &buffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+GLint OpenGLStreamBuffer::write(const void* data, size_t numElements, size_t stride)
+{
+	bind();
+
+	size_t size = numElements * stride;
+	size_t offset = (head + stride - 1) / stride * stride;
+
+	if (offset + size > capacity) {
+		if (size > capacity) capacity = std::max({size, capacity * 2, minCapacity});
+
+		glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		offset = 0;
+	}
+
+	void* mapped = glMapBufferRange(GL_ARRAY_BUFFER,
+		offset,
+		size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	std::memcpy(mapped, data, size);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	head = offset + size;
+
+	return static_cast<GLint>(offset / stride);
+}
+
+void OpenGLStreamBuffer::release(OpenGLDeletionQueue& deletionQueue)
+{
+	deletionQueue.retire(OpenGLObjectType::BUFFER, buffer);
+
+	buffer = 0;
+	capacity = 0;
+	head = 0;
+}
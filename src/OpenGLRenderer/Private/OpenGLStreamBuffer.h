@@ -0,0 +1,36 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+class OpenGLDeletionQueue;
+
+// A vertex buffer for data that changes every frame. Each write goes a little further along, and wrapping
+// around orphans the storage, so nothing written can be something a frame in flight still reads. That is what
+// lets a write map its range unsynchronized -- GL 3.3 has no persistent mapping, and this is the closest it
+// gets. Draw from each write before the next, since the next can orphan it. Render thread only.
+class OpenGLStreamBuffer
+{
+public:
+	OpenGLStreamBuffer();
+
+	OpenGLStreamBuffer(const OpenGLStreamBuffer& other) = delete;
+	OpenGLStreamBuffer& operator=(const OpenGLStreamBuffer& other) = delete;
+
+	/// <summary> Binds it to GL_ARRAY_BUFFER, making it the first time, so a vertex array can point at it.
+	/// Growing or orphaning keeps the name, so the vertex array only has to be set up once. </summary>
+	void bind();
+
+	/// <summary> Copies numElements of stride bytes each in, and leaves it bound. </summary>
+	///
+	/// <returns> Where they start, in elements -- first for glDrawArrays, or the base vertex. </returns>
+	GLint write(const void* data, size_t numElements, size_t stride);
+
+	/// <summary> Hands the buffer to the deletion queue. </summary>
+	void release(OpenGLDeletionQueue& deletionQueue);
+
+private:
+	static const size_t minCapacity = 64 * 1024;
+
+	GLuint buffer;
+	size_t capacity; // in bytes
+	size_t head;	 // where the next write goes, before it is lined up with its stride
+};
@@ -3,9 +3,7 @@
 #include "OpenGLTextBoxWidget.h"
 
 #include "OpenGLFont.h"
-#include "OpenGLMaterialSource.h"
 #include "OpenGLRenderer.h"
-#include "OpenGLWindowWidget.h"
 
 #include <glm-ortho-2d.h>
 
@@ -14,27 +12,13 @@ OpenGLTextBoxWidget::OpenGLTextBoxWidget(Widget* owner, OpenGLRenderer& renderer
 	, renderer(renderer)
 	, thickness(.5f)
 	, size(1.f)
+	, bisLayoutDirty(false)
+	, font(nullptr)
 {
-	renderer.runOnRenderThreadSync([this]
-		{
-			locationIter =
-				this->renderer.textBoxes.get().insert(this->renderer.textBoxes.get().begin(), this);
-
-			// just generate the buffers, there is no data yet.
-			glGenVertexArrays(1, &vertexArray);
-			glGenBuffers(1, &vertLocBuffer);
-			glGenBuffers(1, &texCoordBuffer);
-			glGenBuffers(1, &elemBuffer);
-		});
 }
 
-OpenGLTextBoxWidget::~OpenGLTextBoxWidget()
-{
-	renderer.runOnRenderThreadSync([this]
-		{
-			renderer.textBoxes.get().erase(locationIter);
-		});
-}
+// nothing on the render thread is its own -- the text renderer copies the glyphs every frame
+OpenGLTextBoxWidget::~OpenGLTextBoxWidget() = default;
 
 void OpenGLTextBoxWidget::setText(const std::u16string& textIn)
 {
@@ -43,99 +27,100 @@ void OpenGLTextBoxWidget::setText(const std::u16string& textIn)
 
 		text = textIn;
 
-		regenerateBuffers();
+		// left for draw, so setting it more than once a frame only costs the compare
+		bisLayoutDirty = true;
+		markDirty();
 	}
 }
 
 const std::u16string OpenGLTextBoxWidget::getText() const { return text; }
 
-void OpenGLTextBoxWidget::setSize(float newSize) { size = newSize; }
+void OpenGLTextBoxWidget::setSize(float newSize)
+{
+	if (newSize == size) return;
+
+	size = newSize;
+	markDirty();
+}
 
 float OpenGLTextBoxWidget::getSize() const { return size; }
 
-void OpenGLTextBoxWidget::setThickness(Clampf<0, 0, 1, 0> thicknessIn) { thickness = thicknessIn; }
+void OpenGLTextBoxWidget::setThickness(Clampf<0, 0, 1, 0> thicknessIn)
+{
+	if (static_cast<float>(thicknessIn) == static_cast<float>(thickness)) return;
+
+	thickness = thicknessIn;
+	markDirty();
+}
 
 Clampf<0, 0, 1, 0> OpenGLTextBoxWidget::getThickness() const { return thickness; }
 
-void OpenGLTextBoxWidget::setColor(vec4 colorIn) { color = colorIn; }
+void OpenGLTextBoxWidget::setColor(vec4 colorIn)
+{
+	if (colorIn == color) return;
+
+	color = colorIn;
+	markDirty();
+}
 
 vec4 OpenGLTextBoxWidget::getColor() const { return color; }
 
 void OpenGLTextBoxWidget::setFont(Font* newFont)
 {
 	// if this fails we have problems anyway...
-	font = static_cast<OpenGLFont*>(newFont);
+	auto newOpenGLFont = static_cast<OpenGLFont*>(newFont);
+	if (newOpenGLFont == font) return;
+
+	font = newOpenGLFont;
+	bisLayoutDirty = true;
+	markDirty();
 }
 
 Font* OpenGLTextBoxWidget::getFont() const { return font; }
 
-void OpenGLTextBoxWidget::draw(const mat3& mat) { font->render(*this, glm::translate(mat, getStartRelativeLocation())); }
+void OpenGLTextBoxWidget::draw(const mat3& /*mat*/)
+{
+	if (!font || text.empty()) return;
+
+	if (bisLayoutDirty) layOutGlyphs();
 
-void OpenGLTextBoxWidget::regenerateBuffers()
+	renderer.getTextRenderer().addText(*font,
+		glyphPositions.data(),
+		glyphUVs.data(),
+		text.size(),
+		getWorldMatrix(),
+		color,
+		thickness);
+}
+
+void OpenGLTextBoxWidget::layOutGlyphs()
 {
-	// this MUST be a vector because contiguity is important
-	std::vector<vec2> locations;
-	std::vector<vec2> uvs;
-	std::vector<uvec3> elements;
+	auto numLetters = text.size();
+
+	// resize keeps the memory, so only longer text than ever before allocates
+	glyphPositions.resize(numLetters * 4);
+	glyphUVs.resize(numLetters * 4);
 
 	float cursorpos = 0;
 
-	for (decltype(text.size()) i = 0; i < text.size(); ++i) {
+	for (decltype(text.size()) i = 0; i < numLetters; ++i) {
 		char16_t c = text[i];
 
-		OpenGLCharacterData d = font->getCharacterData(c);
+		auto&& d = font->getCharacterData(c);
 
 		// add uvs
-		uvs.emplace_back(d.uvBegin.x, d.uvEnd.y);				// lower left
-		uvs.emplace_back(d.uvEnd);								// lower right
-		uvs.emplace_back(d.uvBegin);							// upper left
-		uvs.emplace_back(d.uvEnd.x, d.uvBegin.y);				// upper right
-
-		locations.emplace_back(cursorpos + d.offset.x, d.size.y - d.offset.y);				// lower left
-		locations.emplace_back(cursorpos + d.offset.x + d.size.x, d.size.y - d.offset.y);	// lower right
-		locations.emplace_back(cursorpos + d.offset.x, -d.offset.y);							// upper left
-		locations.emplace_back(cursorpos + d.offset.x + d.size.x, -d.offset.y);				// upper right
+		glyphUVs[i * 4] = vec2(d.uvBegin.x, d.uvEnd.y);		// lower left
+		glyphUVs[i * 4 + 1] = d.uvEnd;						// lower right
+		glyphUVs[i * 4 + 2] = d.uvBegin;					// upper left
+		glyphUVs[i * 4 + 3] = vec2(d.uvEnd.x, d.uvBegin.y); // upper right
 
-		elements.emplace_back(i * 4, i * 4 + 1, i * 4 + 2);
-		elements.emplace_back(i * 4 + 1, i * 4 + 2, i * 4 + 3);
+		glyphPositions[i * 4] = vec2(cursorpos + d.offset.x, d.size.y - d.offset.y);			   // lower left
+		glyphPositions[i * 4 + 1] = vec2(cursorpos + d.offset.x + d.size.x, d.size.y - d.offset.y); // lower right
+		glyphPositions[i * 4 + 2] = vec2(cursorpos + d.offset.x, -d.offset.y);					   // upper left
+		glyphPositions[i * 4 + 3] = vec2(cursorpos + d.offset.x + d.size.x, -d.offset.y);		   // upper right
 
 		cursorpos += d.advance;
 	}
 
-	if (text.size() > currentMaxLetters) reallocateBuffers();
-
-	renderer.runOnRenderThreadAsync([
-		this,
-		locations = std::vector<vec2>(std::move(locations)),
-		uvs = std::vector<vec2>(std::move(uvs)),
-		elements = std::vector<uvec3>(std::move(elements))
-	]
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, vertLocBuffer);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vec2) * locations.size(), locations.data());
-
-			glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vec2) * uvs.size(), uvs.data());
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elemBuffer);
-			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uvec3) * elements.size(), elements.data());
-		});
-}
-
-void OpenGLTextBoxWidget::reallocateBuffers()
-{
-	currentMaxLetters = text.size() + 5;
-
-	renderer.runOnRenderThreadAsync([this]
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, vertLocBuffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * currentMaxLetters * 4, nullptr, GL_DYNAMIC_DRAW);
-
-			glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * currentMaxLetters * 4, nullptr, GL_DYNAMIC_DRAW);
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elemBuffer);
-			glBufferData(
-				GL_ELEMENT_ARRAY_BUFFER, sizeof(uvec3) * currentMaxLetters * 2, nullptr, GL_DYNAMIC_DRAW);
-		});
+	bisLayoutDirty = false;
 }
@@ -4,15 +4,16 @@
 #include <TextBoxWidget.h>
 
 #include <string>
+#include <vector>
 
 class Font;
 class OpenGLFont;
 class OpenGLRenderer;
 
+// Text on the UI. Boxes don't draw themselves -- they hand their glyphs to the renderer's
+// OpenGLTextRenderer, which draws every box with the same font at once.
 class OpenGLTextBoxWidget : public MFUI::TextBoxWidget
 {
-	friend class OpenGLFont;
-
 public:
 	OpenGLTextBoxWidget(Widget* owner, OpenGLRenderer& renderer);
 	virtual ~OpenGLTextBoxWidget();
@@ -40,17 +41,15 @@ public:
 	virtual void draw(const mat3& matAtOriginOfParent) override;
 
 private:
-	void regenerateBuffers();
-	void reallocateBuffers();
+	/// <summary> Lays the glyphs out again, for new text or a new font. </summary>
+	void layOutGlyphs();
 
 	std::u16string text;
 
-	uint32 vertexArray;
-	uint32 vertLocBuffer;
-	uint32 texCoordBuffer;
-	uint32 elemBuffer;
-
-	size_t currentMaxLetters = 0;
+	// four corners a glyph, relative to the box -- only worked out again when the text or font changes
+	std::vector<vec2> glyphPositions;
+	std::vector<vec2> glyphUVs;
+	bool bisLayoutDirty;
 
 	vec4 color;
 	float size;
@@ -59,7 +58,5 @@ private:
 
 	OpenGLRenderer& renderer;
 
-	std::list<OpenGLTextBoxWidget*>::iterator locationIter;
-
 	OpenGLFont* font;
-};
\ No newline at end of file
+};
@@ -0,0 +1,193 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLTextRenderer.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLFont.h"
+#include "OpenGLMaterialSource.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLTexture.h"
+#include "OpenGLTextureResidency.h"
+
+#include <algorithm>
+
+OpenGLTextRenderer::OpenGLTextRenderer(OpenGLStateCache& stateCache, OpenGLTextureResidency& residency)
+	: stateCache(stateCache)
+	, residency(residency)
+	, bhasChanged(false)
+	, stats{}
+	, lastStats{}
+	, vertexArray(0)
+	, vertexBuffer(0)
+	, indexBuffer(0)
+	, indexCapacity(0)
+{
+}
+
+void OpenGLTextRenderer::beginUI()
+{
+	for (auto&& batch : batches) batch.vertices.clear();
+
+	bhasChanged = true;
+	stats.numBoxes = 0;
+	stats.numGlyphs = 0;
+}
+
+void OpenGLTextRenderer::addText(OpenGLFont& font,
+	const vec2* positions,
+	const vec2* uvs,
+	size_t numGlyphs,
+	const mat3& transform,
+	vec4 color,
+	float cutoff)
+{
+	if (numGlyphs == 0) return;
+
+	// there are only ever a few fonts
+	auto batch = std::find_if(batches.begin(), batches.end(), [&font](const Batch& batch)
+		{
+			return batch.font == &font;
+		});
+	if (batch == batches.end()) {
+		batches.push_back(Batch{&font, {}});
+		batch = batches.end() - 1;
+	}
+
+	uvec4 bytes = uvec4(glm::clamp(color, 0.f, 1.f) * 255.f + .5f);
+	uint32 packed = bytes.r | bytes.g << 8 | bytes.b << 16 | bytes.a << 24;
+
+	auto&& vertices = batch->vertices;
+	size_t start = vertices.size();
+	vertices.resize(start + numGlyphs * 4);
+
+	for (size_t i = 0; i < numGlyphs * 4; ++i) {
+		auto&& vertex = vertices[start + i];
+		vertex.position = transform * vec3(positions[i], 1.f);
+		vertex.uv = uvs[i];
+		vertex.color = packed;
+		vertex.cutoff = cutoff;
+	}
+
+	++stats.numBoxes;
+	stats.numGlyphs += numGlyphs;
+}
+
+void OpenGLTextRenderer::endFrame()
+{
+	if (bhasChanged) {
+		stats.numDrawCalls = 0;
+		for (auto&& batch : batches) {
+			if (!batch.vertices.empty()) ++stats.numDrawCalls;
+		}
+		++stats.numUploads;
+	}
+
+	bhasChanged = false;
+	lastStats = stats;
+}
+
+void OpenGLTextRenderer::upload(
+	const Range* newRanges, size_t numRanges, const OpenGLGlyphVertex* vertices, size_t numVertices)
+{
+	ranges.assign(newRanges, newRanges + numRanges);
+	if (numVertices == 0) return;
+
+	if (vertexBuffer == 0) glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+	// a new store each time, so frames still drawing the old one don't stall this
+	glBufferData(GL_ARRAY_BUFFER, sizeof(OpenGLGlyphVertex) * numVertices, vertices, GL_DYNAMIC_DRAW);
+}
+
+void OpenGLTextRenderer::draw()
+{
+	for (auto&& range : ranges) {
+		drawRange(range);
+	}
+}
+
+void OpenGLTextRenderer::drawRange(const Range& range)
+{
+	auto&& font = *range.font;
+	auto&& texture = font.getTexture();
+	auto&& source = *font.getMaterialSource();
+
+	// before the check, so an evicted atlas starts loading again
+	residency.touch(*texture.getState());
+
+	// skip it until everything has been uploaded
+	if (!source.isResident() || !texture.isResident()) return;
+
+	if (vertexArray == 0) {
+		glGenVertexArrays(1, &vertexArray);
+		stateCache.bindVertexArray(vertexArray);
+
+		const GLsizei stride = sizeof(OpenGLGlyphVertex);
+
+		// upload always comes first and keeps the name, so this only has to happen once
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(
+			0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(OpenGLGlyphVertex, position)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(
+			1, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(OpenGLGlyphVertex, uv)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(
+			2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(OpenGLGlyphVertex, color)));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(
+			3, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(OpenGLGlyphVertex, cutoff)));
+	}
+
+	stateCache.bindVertexArray(vertexArray);
+	reserveIndices(range.numGlyphs);
+
+	stateCache.useProgram(*source);
+
+	GLint unit = 0;
+	GLint texUniLoc = font.getTexUniformLocation();
+	if (stateCache.shouldSetUniform(texUniLoc, &unit, sizeof(unit))) glUniform1i(texUniLoc, unit);
+	stateCache.bindTexture(unit, texture.getID());
+
+	glDrawElementsBaseVertex(
+		GL_TRIANGLES, static_cast<GLsizei>(range.numGlyphs * 6), GL_UNSIGNED_INT, nullptr, range.baseVertex);
+}
+
+void OpenGLTextRenderer::reserveIndices(size_t numGlyphs)
+{
+	if (numGlyphs <= indexCapacity) return;
+
+	indexCapacity = std::max(numGlyphs, indexCapacity * 2);
+
+	std::vector<uint32> indices(indexCapacity * 6);
+	for (uint32 i = 0; i < indexCapacity; ++i) {
+		uint32 corner = i * 4;
+		uint32* quad = &indices[i * 6];
+
+		quad[0] = corner;
+		quad[1] = corner + 1;
+		quad[2] = corner + 2;
+		quad[3] = corner + 1;
+		quad[4] = corner + 2;
+		quad[5] = corner + 3;
+	}
+
+	// the vertex array is bound, so it picks this up
+	if (indexBuffer == 0) glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32) * indices.size(), indices.data(), GL_STATIC_DRAW);
+}
+
+void OpenGLTextRenderer::releaseBuffers(OpenGLDeletionQueue& deletionQueue)
+{
+	deletionQueue.retire(OpenGLObjectType::VERTEX_ARRAY, vertexArray);
+	deletionQueue.retire(OpenGLObjectType::BUFFER, vertexBuffer);
+	deletionQueue.retire(OpenGLObjectType::BUFFER, indexBuffer);
+
+	vertexArray = 0;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	ranges.clear();
+	indexCapacity = 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <vector>
+
+class OpenGLDeletionQueue;
+class OpenGLFont;
+class OpenGLStateCache;
+class OpenGLTextureResidency;
+
+// What fontvert.glsl reads. Everything a text box sets is in every vertex, so boxes with the same font can
+// go out in one draw.
+struct OpenGLGlyphVertex
+{
+	vec3 position; // through the box's transform already, with w last
+	vec2 uv;
+	uint32 color;  // RGBA8, normalized in the shader
+	float cutoff;  // the box's thickness
+};
+
+struct RenderTextStats
+{
+	uint64 numBoxes;	 // text boxes drawn
+	uint64 numGlyphs;
+	uint64 numDrawCalls; // one a font
+	uint64 numUploads;	 // UI passes, each of which uploaded the glyphs again -- not reset between frames
+};
+
+// Draws every text box on the UI with one draw call per font. Boxes add their glyphs here when the UI is
+// drawn, which only happens when something in it changed. Then all the glyphs are copied into that frame's
+// render data once and uploaded into one vertex buffer, a range per font. Every frame draws that buffer as
+// quads out of a shared index buffer, so a UI that isn't changing costs a draw call a font and nothing else.
+class OpenGLTextRenderer
+{
+public:
+	struct Batch
+	{
+		OpenGLFont* font;
+		std::vector<OpenGLGlyphVertex> vertices; // four a glyph
+	};
+
+	// A font's part of the vertex buffer.
+	struct Range
+	{
+		OpenGLFont* font;
+		GLint baseVertex;
+		size_t numGlyphs;
+	};
+
+	OpenGLTextRenderer(OpenGLStateCache& stateCache, OpenGLTextureResidency& residency);
+
+	OpenGLTextRenderer(const OpenGLTextRenderer& other) = delete;
+	OpenGLTextRenderer& operator=(const OpenGLTextRenderer& other) = delete;
+
+	/// <summary> Starts a UI pass, emptying the batches but keeping their memory. Game thread only.
+	/// </summary>
+	void beginUI();
+
+	/// <summary> Adds a box's glyphs to its font's batch. Only in a UI pass. positions and uvs hold four corners a glyph, in
+	/// the order lower left, lower right, upper left, upper right. Game thread only. </summary>
+	void addText(OpenGLFont& font,
+		const vec2* positions,
+		const vec2* uvs,
+		size_t numGlyphs,
+		const mat3& transform,
+		vec4 color,
+		float cutoff);
+
+	/// <summary> The last UI pass's batches -- the ones without vertices are fonts nothing uses any more.
+	/// Game thread only. </summary>
+	const std::vector<Batch>& getBatches() const { return batches; }
+
+	/// <summary> If there was a UI pass this frame, so the batches have to be uploaded. Game thread only.
+	/// </summary>
+	bool hasChanged() const { return bhasChanged; }
+
+	/// <summary> Call once the frame's text has been recorded. Game thread only. </summary>
+	void endFrame();
+
+	/// <summary> Gets what the last recorded frame drew. Game thread only. </summary>
+	const RenderTextStats& getStats() const { return lastStats; }
+
+	/// <summary> Replaces the vertex buffer with a UI pass's glyphs, a range per font. Render thread only.
+	/// </summary>
+	void upload(const Range* ranges, size_t numRanges, const OpenGLGlyphVertex* vertices, size_t numVertices);
+
+	/// <summary> Draws what was last uploaded. Render thread only. </summary>
+	void draw();
+
+	/// <summary> Hands the buffers to the deletion queue. Render thread only. </summary>
+	void releaseBuffers(OpenGLDeletionQueue& deletionQueue);
+
+private:
+	/// <summary> Draws a font's range of the vertex buffer. </summary>
+	void drawRange(const Range& range);
+
+	/// <summary> Makes sure the index buffer has quads for at least numGlyphs. </summary>
+	void reserveIndices(size_t numGlyphs);
+
+	OpenGLStateCache& stateCache;
+	OpenGLTextureResidency& residency;
+
+	// game thread, kept between passes so they stop allocating
+	std::vector<Batch> batches;
+	bool bhasChanged;
+	RenderTextStats stats;
+	RenderTextStats lastStats;
+
+	// render thread
+	GLuint vertexArray;
+	GLuint vertexBuffer; // everything the last pass drew, only written when there is a new one
+	std::vector<Range> ranges;
+	GLuint indexBuffer; // the same two triangles for every glyph
+	size_t indexCapacity; // in glyphs
+};
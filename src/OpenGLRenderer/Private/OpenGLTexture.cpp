@@ -3,80 +3,106 @@
 #include "OpenGLTexture.h"
 #include "OpenGLRenderer.h"
 
-#include "SOIL/SOIL.h"
-
 #include <Helper.h>
 
+#include <vector>
+
 #define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
 #define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
 #define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
 
 OpenGLTexture::OpenGLTexture(OpenGLRenderer& rendererIn, const path_t& pathIn)
-	: path(pathIn)
+	: state(OpenGLTextureLoader::newState())
+	, path(pathIn)
 	, renderer(rendererIn)
 {
-	if (path != "") {
-
-		renderer.runOnRenderThreadAsync([this]
-			{
-				path_t qualifiedPath = L"textures\\" + path.wstring() + L".dds";
+	if (path != "") initFromFile(L"textures\\" + path.wstring());
+}
 
-				ID = SOIL_load_OGL_texture(qualifiedPath.string().c_str(), // path
-					4,													   // 4 channels
-					0,													   // create a new texture ID in OGL
-					SOIL_FLAG_DDS_LOAD_DIRECT | SOIL_FLAG_MIPMAPS
-						| SOIL_FLAG_POWER_OF_TWO // It is a dds and we want mipmaps
-					);
+OpenGLTexture::~OpenGLTexture()
+{
+	// doesn't wait -- anything this thread already sent that uses the texture runs first
+	auto&& renderer = this->renderer;
 
-				glBindTexture(GL_TEXTURE_2D, ID);
+	renderer.runOnRenderThreadDetached([&renderer, state = this->state]
+		{
+			renderer.getTextureLoader().release(state);
+		});
+}
 
-				// set params
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+void OpenGLTexture::initFromFile(const path_t& filePath)
+{
+	// mipmapped, as textures have always been
+	state->minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	state->magFilter = GL_LINEAR;
 
-			});
-	}
+	renderer.getTextureLoader().load(state, filePath);
 }
 
-OpenGLTexture::~OpenGLTexture()
+void OpenGLTexture::initTileIndices(uvec2 size, const uint16* indices)
 {
-	renderer.runOnRenderThreadSync([this]
+	assert(path.empty());
+
+	// copy it so the caller doesn't have to wait for the upload
+	std::vector<uint16> data(indices, indices + size.x * size.y);
+
+	// only ever fetched, but it still has to be complete without mipmaps
+	state->minFilter = GL_NEAREST;
+	state->magFilter = GL_NEAREST;
+
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, state = this->state, size, data = std::move(data)]
 		{
+			glGenTextures(1, &state->ID);
+			renderer.getStateCache().bindTexture(0, state->ID);
 
-			glDeleteTextures(1, &ID);
+			// normalized, so shaders can keep it in the same sampler array as everything else. 16 bits is
+			// exact once it is scaled back up.
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+			glTexImage2D(
+				GL_TEXTURE_2D, 0, GL_R16, size.x, size.y, 0, GL_RED, GL_UNSIGNED_SHORT, data.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			OpenGLTextureLoader::applySampling(renderer.getStateCache(), *state);
+
+			// counted, but it has no file to come back from, so it stays
+			renderer.getTextureResidency().add(*state, data.size() * sizeof(uint16));
 		});
 }
 
-uint32 OpenGLTexture::getID() { return ID; }
+uint32 OpenGLTexture::getID() { return state->ID; }
 
 void OpenGLTexture::setFilterMode(FilterMode newMode)
 {
-	renderer.runOnRenderThreadAsync([this, newMode]
-		{
-			glBindTexture(GL_TEXTURE_2D, ID);
+	auto&& renderer = this->renderer;
 
+	renderer.runOnRenderThreadDetached([&renderer, state = this->state, newMode]
+		{
 			switch (newMode)
 			{
 			case FilterMode::LINEAR:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				state->minFilter = GL_LINEAR;
+				state->magFilter = GL_LINEAR;
 				break;
 			case FilterMode::NEAREST:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				state->minFilter = GL_NEAREST;
+				state->magFilter = GL_NEAREST;
 				break;
 			case FilterMode::MIPMAP_LINEAR:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				state->minFilter = GL_LINEAR_MIPMAP_LINEAR;
+				state->magFilter = GL_LINEAR;
 				break;
 			case FilterMode::MIPMAP_NEAREST:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				state->minFilter = GL_NEAREST_MIPMAP_NEAREST;
+				state->magFilter = GL_NEAREST;
 				break;
 			default: break;
 			}
+
+			// one that is still loading gets it on upload
+			if (state->ID != 0) OpenGLTextureLoader::applySampling(renderer.getStateCache(), *state);
 		});
 }
 
@@ -84,12 +110,7 @@ Texture::FilterMode OpenGLTexture::getFilterMode() const
 {
 	return renderer.runOnRenderThreadSync([this]
 		{
-			glBindTexture(GL_TEXTURE_2D, ID);
-
-			int mode;
-			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &mode);
-
-			switch (mode)
+			switch (state->minFilter)
 			{
 			case GL_LINEAR: return Texture::FilterMode::LINEAR; break;
 			case GL_NEAREST: return Texture::FilterMode::NEAREST; break;
@@ -102,25 +123,19 @@ Texture::FilterMode OpenGLTexture::getFilterMode() const
 
 void OpenGLTexture::setWrapMode(WrapMode newMode)
 {
-	renderer.runOnRenderThreadAsync([this, newMode]
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, state = this->state, newMode]
 		{
-			glBindTexture(GL_TEXTURE_2D, ID);
 			switch (newMode)
 			{
-			case WrapMode::CLAMP_TO_EDGE:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-				break;
-			case WrapMode::MIRRORED_REPEAT:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-				break;
-			case WrapMode::REPEAT:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-				break;
+			case WrapMode::CLAMP_TO_EDGE: state->wrap = GL_CLAMP_TO_EDGE; break;
+			case WrapMode::MIRRORED_REPEAT: state->wrap = GL_MIRRORED_REPEAT; break;
+			case WrapMode::REPEAT: state->wrap = GL_REPEAT; break;
 			default: break;
 			}
+
+			if (state->ID != 0) OpenGLTextureLoader::applySampling(renderer.getStateCache(), *state);
 		});
 }
 
@@ -128,13 +143,7 @@ Texture::WrapMode OpenGLTexture::getWrapMode() const
 {
 	return renderer.runOnRenderThreadSync([this]
 		{
-			glBindTexture(GL_TEXTURE_2D, ID);
-
-			GLint wrap;
-
-			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap); // retreive the data
-
-			switch (wrap)
+			switch (state->wrap)
 			{
 			case GL_CLAMP_TO_EDGE: return WrapMode::CLAMP_TO_EDGE;
 			case GL_MIRRORED_REPEAT: return WrapMode::MIRRORED_REPEAT;
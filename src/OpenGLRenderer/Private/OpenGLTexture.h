@@ -2,6 +2,8 @@
 
 #include "OpenGLRendererConfig.h"
 
+#include "OpenGLTextureLoader.h"
+
 #include <Texture.h>
 
 #include <map>
@@ -18,8 +20,25 @@ class OpenGLTexture : public Texture
 public:
 	explicit OpenGLTexture(OpenGLRenderer& renderer, const path_t& path = "");
 
+	/// <summary> Loads filePath plus .dds, or plus .png, in the background. Only for one made without a path,
+	/// before anything else is done with it. </summary>
+	void initFromFile(const path_t& filePath);
+
+	/// <summary> Makes this a texture of tile indices. See Renderer::newTileIndexTexture. Only for one made
+	/// without a path. </summary>
+	void initTileIndices(uvec2 size, const uint16* indices);
+
 	uint32 getID();
 
+	/// <summary> If the image has been uploaded yet. Until then the ID is 0, which binds nothing.
+	/// Render thread only. </summary>
+	bool isResident() const { return state->ID != 0; }
+
+	/// <summary> Where the render thread keeps the GL name. It stays put for as long as the texture is
+	/// around, so it can be resolved once and read at draw time -- touch it in the residency first, since an
+	/// evicted texture is only loaded again then. </summary>
+	OpenGLTextureState* getState() const { return state; }
+
 	virtual void setFilterMode(FilterMode mode) override;
 	virtual FilterMode getFilterMode() const override;
 
@@ -29,7 +48,9 @@ public:
 	~OpenGLTexture() override;
 
 private:
-	GLuint ID;
+	// the name only exists once the render thread gets to it, so commands hold on to this instead of the
+	// texture
+	OpenGLTextureState* state; // released to the texture loader by the render thread
 
 	path_t path;
 
@@ -7,78 +7,154 @@
 #include <Logging.h>
 #include <ENGException.h>
 #include <Helper.h>
-#include <vector>
 
-#include "SOIL/SOIL.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 OpenGLTextureLibrary::OpenGLTextureLibrary(OpenGLRenderer& renderer)
-	: nextLocation(0, 0)
+	: texHandle(OpenGLTextureLoader::newState())
+	, individualSize(0)
+	, maxLayers(0)
+	, numLayers(0)
+	, fourCC(0)
+	, numMips(0)
 	, renderer(renderer)
 {
 }
 
-OpenGLTextureLibrary::~OpenGLTextureLibrary() { glDeleteTextures(1, &texHandle); }
+OpenGLTextureLibrary::~OpenGLTextureLibrary()
+{
+	// this used to delete the texture on whatever thread got here. Now it goes to the render thread, after
+	// the uploads this thread already sent.
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, texHandle = this->texHandle]
+		{
+			renderer.getTextureLoader().release(texHandle);
+		});
+}
 
 void OpenGLTextureLibrary::init(uint16 maxElems, uint16 indSize)
 {
+	assert(numLayers == 0);
 
 	individualSize = indSize;
+	maxLayers = maxElems;
+
+	// the texture is made with the first image, once the format is known
+}
 
-	// if it isn't a square number...
-	if (floor(sqrt(float(maxElems))) != sqrt(float(maxElems))) {
-		int c = 1;
-		for (; maxElems >= c * c; ++c)
-			;
+void OpenGLTextureLibrary::addImage(const std::string& name)
+{
+	// more than one color can use the same image
+	if (imageIndices.find(name) != imageIndices.end()) return;
 
-		maxElems = c * c;
+	if (numLayers >= maxLayers) {
+		MFLOG(Error) << "Texture library is full, cannot add " << name;
+		return;
 	}
-	maxElements = maxElems;
 
-	renderer.runOnRenderThreadSync([this]
-		{
+	DDSImage image;
+	if (!DDSImage::load("textures\\" + name + ".dds", image)) {
+		MFLOG(Fatal) << "cannot load dds: " << name;
+	}
+
+	if (image.width != individualSize || image.height != individualSize) {
+		MFLOG(Error) << "Image " << name << " is " << image.width << "x" << image.height
+					 << ", but the library holds images of " << individualSize << "x" << individualSize;
+		return;
+	}
+
+	auto&& renderer = this->renderer;
+
+	if (numLayers == 0) {
+		fourCC = image.fourCC;
+		numMips = image.mipMapCount;
+
+		TextureArrayFile::Header header{{'M', 'F', 'T', 'A'},
+			TextureArrayFile::currentVersion,
+			fourCC,
+			image.width,
+			image.height,
+			maxLayers,
+			numMips};
+
+		renderer.runOnRenderThreadDetached([&renderer, texHandle = this->texHandle, header]
+			{
+				auto size = allocate(renderer.getStateCache(), texHandle->ID, header, {});
+				renderer.getTextureResidency().add(*texHandle, size);
+			});
+	}
+	else if (image.fourCC != fourCC)
+	{
+		MFLOG(Error) << "Image " << name << " isn't compressed the same way as the rest of the library";
+		return;
+	}
 
-			glGenTextures(1, &texHandle);
-			glBindTexture(GL_TEXTURE_2D, texHandle);
+	if (image.mipMapCount < numMips) {
+		MFLOG(Warning) << "Image " << name << " has fewer mip levels than the rest of the library";
+	}
 
-			width = static_cast<uint16>(ceil(sqrt(maxElements)));
+	uint16 layer = numLayers++;
+	imageIndices[name] = layer;
 
-			texHandle = allocateCompressedTextureLibraryFromDDS(width, "textures\\0.dds");
+	renderer.runOnRenderThreadDetached([
+		&renderer,
+		texHandle = this->texHandle,
+		layer,
+		numMips = this->numMips,
+		image = std::move(image)
+	]
+		{
+			uploadLayer(renderer.getStateCache(), texHandle->ID, layer, numMips, image);
 		});
 }
 
-void OpenGLTextureLibrary::addImage(const std::string& name)
+bool OpenGLTextureLibrary::load(const path_t& path)
 {
-	renderer.runOnRenderThreadSync([this, &name]
-		{
-			appendDDS(texHandle,
-				nextLocation.x * individualSize,
-				nextLocation.y * individualSize,
-				("textures\\" + name + ".dds").c_str());
-		});
+	assert(numLayers == 0);
 
-	QuadUVCoords data;
-	data.upperLeft = vec2(nextLocation) / vec2(width);
-	data.upperRight = vec2(nextLocation.x + 1, nextLocation.y) / vec2(width);
-	data.lowerLeft = vec2(nextLocation.x, nextLocation.y + 1) / vec2(width);
-	data.lowerRight = vec2(nextLocation.x + 1, nextLocation.y + 1) / vec2(width);
+	TextureArrayFile file;
+	if (!TextureArrayFile::load(path, file)) return false;
 
-	UVs[name] = data;
+	auto&& header = file.header;
+	if (header.numLayers == 0 || header.numLayers > std::numeric_limits<uint16>::max()) {
+		MFLOG(Warning) << "Texture array " << path << " has " << header.numLayers << " layers";
+		return false;
+	}
 
-	++nextLocation.x;
+	individualSize = static_cast<uint16>(header.width);
+	maxLayers = numLayers = static_cast<uint16>(header.numLayers);
+	fourCC = header.fourCC;
+	numMips = header.numMips;
 
-	if (nextLocation.x >= width) {
-		++nextLocation.y;
-		nextLocation.x = 0;
+	for (uint16 layer = 0; layer < numLayers; ++layer) {
+		imageIndices[file.names[layer]] = layer;
 	}
+
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, texHandle = this->texHandle, file = std::move(file)]
+		{
+			auto size = allocate(renderer.getStateCache(), texHandle->ID, file.header, file.levels);
+			renderer.getTextureResidency().add(*texHandle, size);
+		});
+
+	return true;
 }
 
 boost::optional<QuadUVCoords> OpenGLTextureLibrary::getUVCoords(const std::string& name)
 {
-	auto iter = UVs.find(name);
-
-	// if it exists
-	if (iter != UVs.end()) {
-		return iter->second;
+	// every image has a whole layer to itself
+	if (imageIndices.find(name) != imageIndices.end()) {
+		QuadUVCoords data;
+		data.upperLeft = vec2(0.f, 0.f);
+		data.upperRight = vec2(1.f, 0.f);
+		data.lowerLeft = vec2(0.f, 1.f);
+		data.lowerRight = vec2(1.f, 1.f);
+
+		return data;
 	}
 
 	MFLOG(Warning) << "Cannot find UVCoord named " << name;
@@ -86,31 +162,45 @@ boost::optional<QuadUVCoords> OpenGLTextureLibrary::getUVCoords(const std::strin
 	return boost::optional<QuadUVCoords>(); // return the "null" version
 }
 
-uint32 OpenGLTextureLibrary::getID() { return texHandle; }
+boost::optional<uint16> OpenGLTextureLibrary::getImageIndex(const std::string& name)
+{
+	auto iter = imageIndices.find(name);
+	if (iter != imageIndices.end()) {
+		return iter->second;
+	}
+
+	MFLOG(Warning) << "Cannot find image index named " << name;
+
+	return boost::optional<uint16>();
+}
+
+uint32 OpenGLTextureLibrary::getID() { return texHandle->ID; }
 
 void OpenGLTextureLibrary::setFilterMode(FilterMode newMode)
 {
-	renderer.runOnRenderThreadSync([this, newMode]
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, texHandle = this->texHandle, newMode]
 		{
-			glBindTexture(GL_TEXTURE_2D, texHandle);
+			renderer.getStateCache().bindTextureArray(0, texHandle->ID);
 
 			switch (newMode)
 			{
 			case FilterMode::LINEAR:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 				break;
 			case FilterMode::NEAREST:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 				break;
 			case FilterMode::MIPMAP_LINEAR:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 				break;
 			case FilterMode::MIPMAP_NEAREST:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 				break;
 			default: break;
 			}
@@ -121,10 +211,10 @@ Texture::FilterMode OpenGLTextureLibrary::getFilterMode() const
 {
 	return renderer.runOnRenderThreadSync([this]
 		{
-			glBindTexture(GL_TEXTURE_2D, texHandle);
+			renderer.getStateCache().bindTextureArray(0, texHandle->ID);
 
 			int mode;
-			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &mode);
+			glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, &mode);
 
 			switch (mode)
 			{
@@ -139,22 +229,24 @@ Texture::FilterMode OpenGLTextureLibrary::getFilterMode() const
 
 void OpenGLTextureLibrary::setWrapMode(WrapMode newMode)
 {
-	renderer.runOnRenderThreadAsync([this, newMode]
+	auto&& renderer = this->renderer;
+
+	renderer.runOnRenderThreadDetached([&renderer, texHandle = this->texHandle, newMode]
 		{
-			glBindTexture(GL_TEXTURE_2D, texHandle);
+			renderer.getStateCache().bindTextureArray(0, texHandle->ID);
 			switch (newMode)
 			{
 			case WrapMode::CLAMP_TO_EDGE:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 				break;
 			case WrapMode::MIRRORED_REPEAT:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
 				break;
 			case WrapMode::REPEAT:
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
 				break;
 			default: break;
 			}
@@ -165,11 +257,11 @@ Texture::WrapMode OpenGLTextureLibrary::getWrapMode() const
 {
 	return renderer.runOnRenderThreadSync([this]
 		{
-			glBindTexture(GL_TEXTURE_2D, texHandle);
+			renderer.getStateCache().bindTextureArray(0, texHandle->ID);
 
 			GLint wrap;
 
-			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap); // retreive the
+			glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, &wrap); // retreive the
 																		  // data
 
 			switch (wrap)
@@ -182,145 +274,97 @@ Texture::WrapMode OpenGLTextureLibrary::getWrapMode() const
 		});
 }
 
-#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
-#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
-#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
-
-void OpenGLTextureLibrary::appendDDS(uint32 texToAppend, uint32 Xoffset, uint32 Yoffset, const char* filepath)
+GLenum OpenGLTextureLibrary::getFormat(uint32 fourCC)
 {
-
-	unsigned char header[124];
-
-	FILE* fp;
-
-	/* try to open the file */
-	fopen_s(&fp, filepath, "rb");
-	if (fp == nullptr) MFLOG(Fatal) << "cannot open file: " << filepath;
-
-	/* verify the type of file */
-	char filecode[4];
-	fread(filecode, 1, 4, fp);
-	if (strncmp(filecode, "DDS ", 4) != 0) {
-		fclose(fp);
-		MFLOG(Fatal) << "file not a dds: " << filepath;
-	}
-
-	/* get the surface desc */
-	fread(&header, 124, 1, fp);
-
-	unsigned int height = *reinterpret_cast<unsigned int*>(&(header[8]));
-	unsigned int width = *reinterpret_cast<unsigned int*>(&(header[12]));
-	unsigned int linearSize = *reinterpret_cast<unsigned int*>(&(header[16]));
-	unsigned int mipMapCount = *reinterpret_cast<unsigned int*>(&(header[24]));
-	unsigned int fourCC = *reinterpret_cast<unsigned int*>(&(header[80]));
-
-	unsigned char* buffer;
-	unsigned int bufsize;
-	/* how big is it going to be including all mipmaps? */
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize;
-	buffer = static_cast<unsigned char*>(malloc(bufsize * sizeof(unsigned char)));
-	assert(buffer);
-	fread(buffer, 1, bufsize, fp);
-	/* close the file pointer */
-	fclose(fp);
-
-	// unsigned int components = (fourCC == FOURCC_DXT1) ? 3 : 4;
-	unsigned int format;
 	switch (fourCC)
 	{
-	case FOURCC_DXT1: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
-	case FOURCC_DXT3: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
-	case FOURCC_DXT5: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
-	default: free(buffer); MFLOG(Fatal) << "unrecgnized compressed DDS format: " << filepath;
+	case DDSImage::DXT1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case DDSImage::DXT3: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+	case DDSImage::DXT5: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; // DDSImage doesn't load anything else
 	}
-
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-	unsigned int offset = 0;
-
-	glBindTexture(GL_TEXTURE_2D, texToAppend);
-
-	for (unsigned int level = 0; level < mipMapCount && (width || height); ++level) {
-
-		unsigned int size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
-
-		// these need to be a multiple of 4 according to the S3TC spec
-		if (Xoffset % 4 == 0 && Yoffset % 4 == 0 && width % 4 == 0 && height % 4 == 0) {
-			glCompressedTexSubImage2D(
-				GL_TEXTURE_2D, level, Xoffset, Yoffset, width, height, format, size, buffer + offset);
-		}
-
-		offset += size;
-		width /= 2;
-		height /= 2;
-		Xoffset /= 2;
-		Yoffset /= 2;
-	}
-	free(buffer);
 }
 
-uint32 OpenGLTextureLibrary::allocateCompressedTextureLibraryFromDDS(uint32 num, const char* filepath)
+size_t OpenGLTextureLibrary::allocate(OpenGLStateCache& state,
+	GLuint& texture,
+	const TextureArrayFile::Header& header,
+	const std::vector<std::vector<uint8>>& levels)
 {
-	unsigned char header[124];
-
-	FILE* fp;
-
-	/* try to open the file */
-	fopen_s(&fp, filepath, "rb");
-	if (fp == nullptr) return 0;
+	GLenum format = getFormat(header.fourCC);
 
-	/* verify the type of file */
-	char filecode[4];
-	fread(filecode, 1, 4, fp);
-	if (strncmp(filecode, "DDS ", 4) != 0) {
-		fclose(fp);
-		return 0;
-	}
-
-	/* get the surface desc */
-	fread(&header, 124, 1, fp);
-
-	unsigned int height = *reinterpret_cast<unsigned int*>(&(header[8]));
-	unsigned int width = *reinterpret_cast<unsigned int*>(&(header[12]));
-	// unsigned int linearSize = *reinterpret_cast<unsigned int*>(&(header[16]));
-	unsigned int mipMapCount = *reinterpret_cast<unsigned int*>(&(header[24]));
-	unsigned int fourCC = *reinterpret_cast<unsigned int*>(&(header[80]));
-
-	unsigned int format;
-	switch (fourCC)
-	{
-	case FOURCC_DXT1: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
-	case FOURCC_DXT3: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
-	case FOURCC_DXT5: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
-	default: return 0;
-	}
-
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-	// unsigned int offset = 0;
-
-	uint32 texture;
 	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-
-	int extraMips = static_cast<int>(floorf(log2f(static_cast<float>(num))));
-	mipMapCount += extraMips;
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipMapCount - 1);
-
-	width *= num;
-	height *= num;
-	uint32 size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
-
-	std::vector<GLubyte> zeros(size);
+	state.bindTextureArray(0, texture);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, header.numMips - 1);
+	glTexParameteri(
+		GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, header.numMips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// levels that weren't given start out empty, for the layers to go into one at a time
+	std::vector<uint8> zeros;
+	size_t totalSize = 0;
+
+	for (uint32 level = 0; level < header.numMips; ++level) {
+		GLsizei width = std::max(header.width >> level, 1u);
+		GLsizei height = std::max(header.height >> level, 1u);
+		size_t layerSize = DDSImage::getLevelSize(header.fourCC, header.width, header.height, level);
+		size_t size = layerSize * header.numLayers;
+
+		const uint8* data;
+		if (level < levels.size()) {
+			assert(levels[level].size() == size);
+			data = levels[level].data();
+		}
+		else
+		{
+			zeros.resize(size);
+			data = zeros.data();
+		}
 
-	for (uint32 i = 0; i < mipMapCount; i++) {
+		// every layer at once
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY,
+			level,
+			format,
+			width,
+			height,
+			header.numLayers,
+			0,
+			static_cast<GLsizei>(size),
+			data);
+
+		totalSize += size;
+	}
 
-		size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	return totalSize;
+}
 
-		glCompressedTexImage2D(GL_TEXTURE_2D, i, format, width, height, 0, size, &zeros[0]);
+void OpenGLTextureLibrary::uploadLayer(
+	OpenGLStateCache& state, GLuint texture, uint32 layer, uint32 numMips, const DDSImage& image)
+{
+	GLenum format = getFormat(image.fourCC);
+
+	state.bindTextureArray(0, texture);
+
+	// the layer is the whole of each level, so there is no offset to line up with the blocks
+	size_t offset = 0;
+	for (uint32 level = 0; level < image.mipMapCount && level < numMips; ++level) {
+		GLsizei width = std::max(image.width >> level, 1u);
+		GLsizei height = std::max(image.height >> level, 1u);
+		size_t size = DDSImage::getLevelSize(image.fourCC, image.width, image.height, level);
+
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+			level,
+			0,
+			0,
+			layer,
+			width,
+			height,
+			1,
+			format,
+			static_cast<GLsizei>(size),
+			image.data.data() + offset);
 
-		width /= 2;
-		height /= 2;
+		offset += size;
 	}
-	return texture;
 }
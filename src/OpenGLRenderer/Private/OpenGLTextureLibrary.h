@@ -2,12 +2,19 @@
 
 #include "OpenGLRendererConfig.h"
 
+#include "OpenGLTextureResidency.h"
+
 #include <TextureLibrary.h>
+#include <TextureArrayFile.h>
 
 #include <map>
+#include <vector>
 
 class OpenGLRenderer;
+class OpenGLStateCache;
 
+// A texture library as a GL_TEXTURE_2D_ARRAY, one image a layer. Images don't share mip levels, so they
+// can't bleed into each other, and any number of them fits without rounding up to a square.
 class OpenGLTextureLibrary : public TextureLibrary
 {
 public:
@@ -17,7 +24,9 @@ public:
 
 	// from TextureLibrary
 	virtual void addImage(const std::string& name) override;
+	virtual bool load(const path_t& path) override;
 	virtual boost::optional<QuadUVCoords> getUVCoords(const std::string& name) override;
+	virtual boost::optional<uint16> getImageIndex(const std::string& name) override;
 	virtual void init(uint16 maxElems, uint16 individualSize) override;
 
 	// from Texture
@@ -29,19 +38,38 @@ public:
 
 	uint32 getID();
 
-private:
-	GLuint texHandle;
+	/// <summary> If the library texture has been created yet. Render thread only. </summary>
+	bool isResident() const { return texHandle->ID != 0; }
 
-	uvec2 nextLocation;
+	/// <summary> Where the render thread keeps the GL name. See OpenGLTexture::getState. Libraries are
+	/// counted against the texture budget but never evicted, since their layers come from memory. </summary>
+	OpenGLTextureState* getState() const { return texHandle; }
+
+private:
+	// the name only exists once the render thread gets to it, so commands hold on to this instead of the
+	// library
+	OpenGLTextureState* texHandle; // released to the texture loader by the render thread
 
 	uint16 individualSize;
-	uint16 maxElements;
-	uint16 width;
+	uint16 maxLayers;
+	uint16 numLayers;
+
+	// taken from the first image -- the rest have to match
+	uint32 fourCC;
+	uint32 numMips;
 
-	std::map<std::string, QuadUVCoords> UVs;
+	std::map<std::string, uint16> imageIndices;
 
 	OpenGLRenderer& renderer;
 
-	void appendDDS(uint32 texToAppend, uint32 Xoffset, uint32 Yoffset, const char* filepath);
-	uint32 allocateCompressedTextureLibraryFromDDS(uint32 num, const char* filepath);
-};
\ No newline at end of file
+	static GLenum getFormat(uint32 fourCC);
+
+	// these only upload, on the render thread
+	// levels can be empty, to upload the layers one at a time after. Returns how big it is, every level.
+	static size_t allocate(OpenGLStateCache& state,
+		GLuint& texture,
+		const TextureArrayFile::Header& header,
+		const std::vector<std::vector<uint8>>& levels);
+	static void uploadLayer(
+		OpenGLStateCache& state, GLuint texture, uint32 layer, uint32 numMips, const DDSImage& image);
+};
@@ -0,0 +1,310 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLTextureLoader.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLStateCache.h"
+
+#include <lodepng.h>
+
+#include <algorithm>
+#include <cstring>
+
+OpenGLTextureLoader::OpenGLTextureLoader(
+	OpenGLStateCache& stateCache, OpenGLDeletionQueue& deletionQueue, OpenGLTextureResidency& residency)
+	: stateCache(stateCache)
+	, deletionQueue(deletionQueue)
+	, residency(residency)
+	, uploadBudget(0)
+	, unpackBuffer(0)
+	, numDecoding(0)
+	, numLoaded(0)
+	, numFailed(0)
+	, bytesUploaded(0)
+	, decodeNanoseconds(0)
+{
+}
+
+void OpenGLTextureLoader::start(uint32 numThreads, size_t budget)
+{
+	assert(!workers);
+
+	uploadBudget = budget;
+	workers = std::make_unique<WorkerPool>(numThreads);
+}
+
+OpenGLTextureState* OpenGLTextureLoader::newState()
+{
+	auto ret = new OpenGLTextureState;
+	ret->ID = 0;
+	ret->minFilter = GL_NEAREST_MIPMAP_LINEAR;
+	ret->magFilter = GL_LINEAR;
+	ret->wrap = GL_REPEAT;
+	ret->bisLoading = false;
+	ret->bisReleased = false;
+	ret->residentBytes = 0;
+	ret->lastUsedFrame = 0;
+	ret->residencySlot = OpenGLTextureResidency::untracked;
+	ret->bisEvicted = false;
+
+	return ret;
+}
+
+void OpenGLTextureLoader::load(OpenGLTextureState* state, const path_t& path)
+{
+	assert(workers);
+
+	// either nothing else has seen the state yet, or this is the render thread, so this is safe here
+	state->bisLoading = true;
+	state->reloadPath = path;
+
+	{
+		std::lock_guard<std::mutex> lock{decodedMutex};
+		++numDecoding;
+	}
+
+	// the workers only decode -- the state is the render thread's, and goes back there with the pixels
+	workers->post([this, state, path]
+		{
+			decode(state, path);
+		});
+}
+
+void OpenGLTextureLoader::decode(OpenGLTextureState* state, const path_t& path)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Decoded ret;
+	ret.state = state;
+	ret.path = path;
+	ret.bisFailed = false;
+	ret.bisCompressed = true;
+
+	path_t ddsPath = path.wstring() + L".dds";
+	path_t pngPath = path.wstring() + L".png";
+
+	// whatever happens, the result has to be handed back, or finishLoading waits for it forever
+	try
+	{
+		if (boost::filesystem::exists(ddsPath)) {
+			ret.bisFailed = !DDSImage::load(ddsPath, ret.image);
+		}
+		else
+		{
+			ret.bisCompressed = false;
+
+			auto&& image = ret.image;
+			unsigned width = 0;
+			unsigned height = 0;
+			if (unsigned error = lodepng::decode(image.data, width, height, pngPath.string())) {
+				MFLOG(Warning) << "Could not load " << pngPath << ": " << lodepng_error_text(error);
+				ret.bisFailed = true;
+			}
+
+			image.width = width;
+			image.height = height;
+			image.mipMapCount = 1; // the rest are made on upload
+			image.fourCC = 0;
+		}
+	}
+	catch (ENGException& e) // doesn't derive from std::exception publicly, so it needs its own
+	{
+		MFLOG(Warning) << "Could not decode " << path << ": " << e.what();
+		ret.bisFailed = true;
+	}
+	catch (std::exception& e)
+	{
+		MFLOG(Warning) << "Could not decode " << path << ": " << e.what();
+		ret.bisFailed = true;
+	}
+	catch (...)
+	{
+		MFLOG(Warning) << "Could not decode " << path;
+		ret.bisFailed = true;
+	}
+
+	// a warning, as an error would throw on the worker -- the texture just stays unloaded
+	if (ret.bisFailed) MFLOG(Warning) << "Could not load texture " << path;
+
+	decodeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	{
+		std::lock_guard<std::mutex> lock{decodedMutex};
+		decoded.push_back(std::move(ret));
+		--numDecoding;
+	}
+	decodedReady.notify_all();
+}
+
+void OpenGLTextureLoader::uploadPending()
+{
+	// take this frame's share while holding the lock, and upload without it
+	std::vector<Decoded> toUpload;
+	{
+		std::lock_guard<std::mutex> lock{decodedMutex};
+
+		size_t budgetUsed = 0;
+		while (!decoded.empty()) {
+			size_t size = decoded.front().image.data.size();
+			if (!toUpload.empty() && budgetUsed + size > uploadBudget) break;
+
+			budgetUsed += size;
+
+			toUpload.push_back(std::move(decoded.front()));
+			decoded.pop_front();
+		}
+	}
+
+	for (auto&& image : toUpload) {
+		upload(image);
+	}
+}
+
+void OpenGLTextureLoader::finishLoading()
+{
+	std::deque<Decoded> toUpload;
+	{
+		std::unique_lock<std::mutex> lock{decodedMutex};
+		decodedReady.wait(lock, [this]
+			{
+				return numDecoding == 0;
+			});
+
+		toUpload.swap(decoded);
+	}
+
+	for (auto&& image : toUpload) {
+		upload(image);
+	}
+}
+
+void OpenGLTextureLoader::upload(Decoded& decoded)
+{
+	auto&& state = *decoded.state;
+	state.bisLoading = false;
+
+	// its texture went away while it was loading
+	if (state.bisReleased) {
+		delete decoded.state;
+		return;
+	}
+
+	if (decoded.bisFailed) {
+		++numFailed;
+		return;
+	}
+
+	auto&& image = decoded.image;
+
+	// copy it into the unpack buffer, orphaning what the last upload used so this doesn't wait on it, and
+	// the driver takes it from there without the render thread waiting for the transfer
+	if (unpackBuffer == 0) glGenBuffers(1, &unpackBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, image.data.size(), nullptr, GL_STREAM_DRAW);
+
+	void* mapped = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER, 0, image.data.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	std::memcpy(mapped, image.data.data(), image.data.size());
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glGenTextures(1, &state.ID);
+	stateCache.bindTexture(0, state.ID);
+
+	// with an unpack buffer bound, the data pointers are offsets into it
+	if (decoded.bisCompressed) {
+		GLenum format;
+		switch (image.fourCC)
+		{
+		case DDSImage::DXT1: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+		case DDSImage::DXT3: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+		default: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break; // DDSImage doesn't load anything else
+		}
+
+		size_t offset = 0;
+		for (uint32 level = 0; level < image.mipMapCount; ++level) {
+			GLsizei width = std::max(image.width >> level, 1u);
+			GLsizei height = std::max(image.height >> level, 1u);
+			size_t size = DDSImage::getLevelSize(image.fourCC, image.width, image.height, level);
+
+			glCompressedTexImage2D(GL_TEXTURE_2D,
+				level,
+				format,
+				width,
+				height,
+				0,
+				static_cast<GLsizei>(size),
+				reinterpret_cast<const void*>(offset));
+
+			offset += size;
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mipMapCount - 1);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D,
+			0,
+			GL_RGBA8,
+			image.width,
+			image.height,
+			0,
+			GL_RGBA,
+			GL_UNSIGNED_BYTE,
+			nullptr);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	// everything else that uploads passes pointers to its own memory
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	applySampling(stateCache, state);
+
+	// the driver makes the rest of the mip chain for a .png, which is about another third
+	residency.add(state, decoded.bisCompressed ? image.data.size() : image.data.size() / 3 * 4);
+
+	++numLoaded;
+	bytesUploaded += image.data.size();
+}
+
+void OpenGLTextureLoader::release(OpenGLTextureState* state)
+{
+	if (state->bisLoading) {
+		state->bisReleased = true;
+		return;
+	}
+
+	residency.remove(*state);
+	deletionQueue.retire(OpenGLObjectType::TEXTURE, state->ID);
+	delete state;
+}
+
+void OpenGLTextureLoader::applySampling(OpenGLStateCache& stateCache, const OpenGLTextureState& state)
+{
+	stateCache.bindTexture(0, state.ID);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, state.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, state.magFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, state.wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, state.wrap);
+}
+
+void OpenGLTextureLoader::releaseBuffers()
+{
+	deletionQueue.retire(OpenGLObjectType::BUFFER, unpackBuffer);
+	unpackBuffer = 0;
+}
+
+OpenGLTextureLoadStats OpenGLTextureLoader::getStats() const
+{
+	OpenGLTextureLoadStats ret;
+	ret.numLoaded = numLoaded;
+	ret.numFailed = numFailed;
+	ret.bytesUploaded = bytesUploaded;
+	ret.decodeTime = std::chrono::nanoseconds(decodeNanoseconds.load());
+
+	std::lock_guard<std::mutex> lock{decodedMutex};
+	ret.numWaiting = decoded.size();
+
+	return ret;
+}
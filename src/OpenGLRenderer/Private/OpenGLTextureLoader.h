@@ -0,0 +1,105 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLTextureResidency.h"
+
+#include <DDSImage.h>
+#include <WorkerPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class OpenGLStateCache;
+class OpenGLDeletionQueue;
+
+struct OpenGLTextureLoadStats
+{
+	uint64 numLoaded;					 // images that made it to the GPU
+	uint64 numFailed;					 // images that couldn't be read
+	uint64 bytesUploaded;				 // through the unpack buffer
+	size_t numWaiting;					 // decoded, waiting for a frame with budget left
+	std::chrono::nanoseconds decodeTime; // spent reading and decoding on the workers
+};
+
+// Reads and decodes .dds and .png images on a pool of workers, then uploads them on the render thread
+// through a pixel unpack buffer, a few each frame. A frame only uploads up to its budget of bytes, so a
+// burst of new textures is spread over frames instead of making one of them hitch -- though every frame
+// gets at least one image, however big.
+class OpenGLTextureLoader
+{
+public:
+	OpenGLTextureLoader(
+		OpenGLStateCache& stateCache, OpenGLDeletionQueue& deletionQueue, OpenGLTextureResidency& residency);
+
+	OpenGLTextureLoader(const OpenGLTextureLoader& other) = delete;
+	OpenGLTextureLoader& operator=(const OpenGLTextureLoader& other) = delete;
+
+	/// <summary> Starts the workers. Call once, before anything is loaded. </summary>
+	void start(uint32 numThreads, size_t uploadBudget);
+
+	/// <summary> Makes the state for a new texture, with GL's default sampling. </summary>
+	static OpenGLTextureState* newState();
+
+	/// <summary> Loads path plus .dds, or path plus .png if there isn't one, into state, and remembers path
+	/// so residency can evict it and load it again. From any thread while nothing else has state, then only
+	/// the render thread. </summary>
+	void load(OpenGLTextureState* state, const path_t& path);
+
+	/// <summary> Uploads what the workers have finished, until this frame's budget runs out. Render thread
+	/// only. </summary>
+	void uploadPending();
+
+	/// <summary> Waits for every load that has been started and uploads them all, budget or not. For when
+	/// there is nothing to show until they are in, like the loading image. Render thread only. </summary>
+	void finishLoading();
+
+	/// <summary> Stops counting the texture against the budget, retires it and deletes state, or leaves that
+	/// to the load it is waiting on. Render thread only. </summary>
+	void release(OpenGLTextureState* state);
+
+	/// <summary> Sets the state's sampling on its texture. Render thread only. </summary>
+	static void applySampling(OpenGLStateCache& stateCache, const OpenGLTextureState& state);
+
+	/// <summary> Retires the unpack buffer. Render thread only. </summary>
+	void releaseBuffers();
+
+	/// <summary> Safe from any thread. </summary>
+	OpenGLTextureLoadStats getStats() const;
+
+private:
+	struct Decoded
+	{
+		OpenGLTextureState* state;
+		path_t path;
+		bool bisFailed;
+		bool bisCompressed; // a DXT .dds -- otherwise RGBA8 from a .png
+		DDSImage image;		// the pixels either way, with fourCC 0 for a .png
+	};
+
+	void decode(OpenGLTextureState* state, const path_t& path);
+	void upload(Decoded& decoded);
+
+	OpenGLStateCache& stateCache;
+	OpenGLDeletionQueue& deletionQueue;
+	OpenGLTextureResidency& residency;
+
+	size_t uploadBudget;
+	GLuint unpackBuffer; // render thread only
+
+	mutable std::mutex decodedMutex;
+	std::condition_variable decodedReady;
+	std::deque<Decoded> decoded;
+	uint32 numDecoding; // posted, and not in decoded yet
+
+	std::atomic<uint64> numLoaded;
+	std::atomic<uint64> numFailed;
+	std::atomic<uint64> bytesUploaded;
+	std::atomic<int64> decodeNanoseconds;
+
+	std::unique_ptr<WorkerPool> workers; // last, so its threads are gone before anything they use
+};
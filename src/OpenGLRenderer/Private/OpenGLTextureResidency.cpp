@@ -0,0 +1,107 @@
+#include "OpenGLRendererPCH.h"
+
+#include "OpenGLTextureResidency.h"
+
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLTextureLoader.h"
+
+#include <algorithm>
+
+OpenGLTextureResidency::OpenGLTextureResidency(OpenGLDeletionQueue& deletionQueue, OpenGLTextureLoader& loader)
+	: deletionQueue(deletionQueue)
+	, loader(loader)
+	, budget(0)
+	, frame(1)
+	, stats{}
+	, lastStats{}
+{
+}
+
+void OpenGLTextureResidency::add(OpenGLTextureState& state, size_t bytes)
+{
+	assert(state.residencySlot == untracked);
+
+	state.residentBytes = bytes;
+	state.lastUsedFrame = frame; // so it isn't the first to go before anything has had a chance to use it
+	state.residencySlot = static_cast<uint32>(resident.size());
+	resident.push_back(&state);
+
+	stats.residentBytes += bytes;
+	stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+}
+
+void OpenGLTextureResidency::remove(OpenGLTextureState& state)
+{
+	if (state.residencySlot == untracked) return;
+
+	// swap the last one into its slot
+	auto last = resident.back();
+	last->residencySlot = state.residencySlot;
+	resident[state.residencySlot] = last;
+	resident.pop_back();
+
+	stats.residentBytes -= state.residentBytes;
+
+	state.residencySlot = untracked;
+	state.residentBytes = 0;
+}
+
+void OpenGLTextureResidency::reload(OpenGLTextureState& state)
+{
+	// the loader clears bisLoading when it comes back, and counts it again then
+	state.bisEvicted = false;
+	loader.load(&state, state.reloadPath);
+
+	++stats.numReloads;
+}
+
+void OpenGLTextureResidency::evict(OpenGLTextureState& state)
+{
+	remove(state);
+
+	deletionQueue.retire(OpenGLObjectType::TEXTURE, state.ID);
+	state.ID = 0;
+	state.bisEvicted = true;
+
+	++stats.numEvictions;
+}
+
+void OpenGLTextureResidency::endFrame()
+{
+	if (budget != 0 && stats.residentBytes > budget) {
+		// anything drawn this frame stays, or it would just be loaded again next frame
+		candidates.clear();
+		for (auto state : resident) {
+			if (!state->reloadPath.empty() && state->lastUsedFrame != frame) candidates.push_back(state);
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](OpenGLTextureState* a, OpenGLTextureState* b)
+			{
+				return a->lastUsedFrame < b->lastUsedFrame;
+			});
+
+		for (auto state : candidates) {
+			if (stats.residentBytes <= budget) break;
+
+			evict(*state);
+		}
+	}
+
+	++frame;
+
+	stats.budget = budget;
+	stats.numResident = resident.size();
+	stats.numEvictable = std::count_if(resident.begin(), resident.end(), [](OpenGLTextureState* state)
+		{
+			return !state->reloadPath.empty();
+		});
+
+	std::lock_guard<std::mutex> lock{statsMutex};
+	lastStats = stats;
+}
+
+OpenGLResidencyStats OpenGLTextureResidency::getStats() const
+{
+	std::lock_guard<std::mutex> lock{statsMutex};
+	return lastStats;
+}
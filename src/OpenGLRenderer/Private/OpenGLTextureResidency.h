@@ -0,0 +1,96 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include <mutex>
+#include <vector>
+
+class OpenGLDeletionQueue;
+class OpenGLTextureLoader;
+
+// What the render thread knows about a texture or texture library. The owner gives it to
+// OpenGLTextureLoader::release instead of deleting it, since a load can still be on its way back. Render
+// thread only, once it has been handed over.
+struct OpenGLTextureState
+{
+	GLuint ID; // 0 until it has been uploaded, and again while it is evicted
+	GLint minFilter;
+	GLint magFilter;
+	GLint wrap;
+	bool bisLoading;  // a worker has it, or it is waiting for upload budget
+	bool bisReleased; // the texture is gone -- the loader deletes this once the load comes back
+
+	// for OpenGLTextureResidency
+	path_t reloadPath;	   // what the loader can load it from again -- empty keeps it resident
+	size_t residentBytes;  // about how much video memory it takes, or 0 if it isn't tracked
+	uint64 lastUsedFrame;
+	uint32 residencySlot;  // OpenGLTextureResidency::untracked until it is uploaded
+	bool bisEvicted;
+};
+
+struct OpenGLResidencyStats
+{
+	size_t budget;			 // 0 for no limit
+	size_t residentBytes;	 // estimated, for every texture and library that is uploaded
+	size_t peakResidentBytes;
+	size_t numResident;
+	size_t numEvictable;	 // resident, and could be loaded again
+	uint64 numEvictions;
+	uint64 numReloads;		 // evicted textures that were used again
+};
+
+// Keeps the textures on the GPU under a budget. Every texture and library is counted once it is uploaded,
+// and remembers the last frame it was used. When a frame ends over budget, the textures that have gone
+// unused longest are deleted until it isn't -- only ones loaded from a file, since those can be loaded again
+// the next time something uses them. Render thread only, unless noted.
+class OpenGLTextureResidency
+{
+public:
+	static const uint32 untracked = ~0u;
+
+	OpenGLTextureResidency(OpenGLDeletionQueue& deletionQueue, OpenGLTextureLoader& loader);
+
+	OpenGLTextureResidency(const OpenGLTextureResidency& other) = delete;
+	OpenGLTextureResidency& operator=(const OpenGLTextureResidency& other) = delete;
+
+	/// <summary> Sets the budget in bytes, 0 for none. Before the render thread starts. </summary>
+	void setBudget(size_t newBudget) { budget = newBudget; }
+
+	/// <summary> Starts counting a texture that was just uploaded. </summary>
+	void add(OpenGLTextureState& state, size_t bytes);
+
+	/// <summary> Stops counting it, when it is released. </summary>
+	void remove(OpenGLTextureState& state);
+
+	/// <summary> Marks state as used this frame, and starts loading it again if it was evicted. Call
+	/// whenever something binds it. </summary>
+	void touch(OpenGLTextureState& state)
+	{
+		state.lastUsedFrame = frame;
+		if (state.bisEvicted) reload(state);
+	}
+
+	/// <summary> Evicts down to the budget and moves on to the next frame. Call after the frame's last
+	/// command. </summary>
+	void endFrame();
+
+	/// <summary> Gets the numbers as of the last endFrame. Safe from any thread. </summary>
+	OpenGLResidencyStats getStats() const;
+
+private:
+	void reload(OpenGLTextureState& state);
+	void evict(OpenGLTextureState& state);
+
+	OpenGLDeletionQueue& deletionQueue;
+	OpenGLTextureLoader& loader;
+
+	size_t budget;
+	uint64 frame;
+
+	std::vector<OpenGLTextureState*> resident; // by residencySlot
+	std::vector<OpenGLTextureState*> candidates; // kept so eviction doesn't allocate
+
+	OpenGLResidencyStats stats;
+
+	mutable std::mutex statsMutex;
+	OpenGLResidencyStats lastStats;
+};
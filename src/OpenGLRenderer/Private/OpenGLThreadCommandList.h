@@ -0,0 +1,69 @@
+#pragma once
+#include "OpenGLRendererConfig.h"
+
+#include "OpenGLCommandBuffer.h"
+#include "OpenGLSegmentedQueue.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct RenderSubmissionStats
+{
+	std::thread::id threadID;	 // the thread using the list now
+	uint64 numImmediateCommands; // runOnRenderThread*
+	uint64 numRecordedCommands;	 // recordRenderCommand
+};
+
+struct RenderQueueFrameStats
+{
+	size_t peakDepth;					// most commands waiting in any one thread's queue
+	uint64 numStalls;					// times a thread was held back at the high water mark
+	std::chrono::nanoseconds stallTime; // total time threads spent held back
+};
+
+// Everything one thread has sent to the render thread. Only the owning thread pushes to queue, so the spsc
+// contract holds however many threads submit work. The render thread merges the lists in registration order.
+// When a thread exits its list goes to the next thread to register, counts and anything still queued included.
+struct OpenGLThreadCommandList
+{
+	// one is recorded into while the rest are queued or rendering
+	static const uint32 numFrameBuffers = 4;
+
+	OpenGLThreadCommandList(uint32 index, std::thread::id threadID, size_t highWaterMark, size_t lowWaterMark)
+		: index(index)
+		, threadID(threadID)
+		, queue(highWaterMark, lowWaterMark)
+		, numImmediateCommands(0)
+		, numRecordedCommands(0)
+	{
+	}
+
+	OpenGLThreadCommandList(const OpenGLThreadCommandList& other) = delete;
+	OpenGLThreadCommandList& operator=(const OpenGLThreadCommandList& other) = delete;
+
+	RenderSubmissionStats getStats() const
+	{
+		RenderSubmissionStats ret;
+
+		ret.threadID = threadID;
+		ret.numImmediateCommands = numImmediateCommands;
+		ret.numRecordedCommands = numRecordedCommands;
+
+		return ret;
+	}
+
+	const uint32 index;
+	std::atomic<std::thread::id> threadID; // changes when the list is handed to another thread
+
+	OpenGLSegmentedQueue<std::function<void()>> queue;
+
+	// held while recording so a frame can't be submitted halfway through a command
+	std::mutex frameMutex;
+	std::array<OpenGLCommandBuffer, numFrameBuffers> frameCommands;
+
+	std::atomic<uint64> numImmediateCommands;
+	std::atomic<uint64> numRecordedCommands;
+};
@@ -29,13 +29,17 @@ OpenGLWindowWidget::OpenGLWindowWidget(OpenGLRenderer& renderer)
 	GLFWmonitor* mon = glfwGetPrimaryMonitor();
 	const GLFWvidmode* mode = glfwGetVideoMode(mon);
 
-	renderer.runOnRenderThreadAsync([this, mon, mode, size]
+	// with FXAA the scene is multisampled in a framebuffer of its own instead
+	uint32 samples = renderer.getPresenter().getWindowSamples();
+
+	renderer.runOnRenderThreadAsync([this, &renderer, mon, mode, size, samples]
 		{
 
 			// set AA
-			glfwWindowHint(GLFW_SAMPLES, 8);
+			glfwWindowHint(GLFW_SAMPLES, samples);
 
-			glfwWindowHint(GL_DOUBLEBUFFER, false);
+			// the presenter decides how many frames can queue up behind the one on screen
+			glfwWindowHint(GLFW_DOUBLEBUFFER, true);
 
 			// set GL version
 			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -99,6 +103,8 @@ OpenGLWindowWidget::OpenGLWindowWidget(OpenGLRenderer& renderer)
 			glfwSetScrollCallback(window, &OpenGLWindowWidget::scrollCallback);
 
 			glfwSetWindowFocusCallback(window, &OpenGLWindowWidget::focusCallback);
+
+			renderer.getPresenter().init(window);
 		});
 }
 
@@ -202,9 +208,9 @@ bool OpenGLWindowWidget::shouldClose()
 
 void OpenGLWindowWidget::postDraw(const mat3& /*mat*/)
 {
-	renderer.runOnRenderThreadAsync([this]
+	renderer.recordRenderCommand([this]
 		{
-			glfwSwapBuffers(window);
+			renderer.getPresenter().present(window);
 			glfwPollEvents();
 		});
 }
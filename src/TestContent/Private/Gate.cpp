@@ -6,6 +6,7 @@
 #include <Texture.h>
 #include <Renderer.h>
 #include <MaterialInstance.h>
+#include <MaterialSource.h>
 #include <ModelData.h>
 #include <TimerManager.h>
 
@@ -22,14 +23,18 @@ Gate::Gate()
 
 	tex->setFilterMode(Texture::FilterMode::MIPMAP_LINEAR);
 
-	mat = Runtime::get().getRenderer().newMaterialInstance(
-		Runtime::get().getRenderer().getMaterialSource("animation"));
-	mat->setProperty("tiles", 2);
-	mat->setUpdateCallback([time = 0.f](MaterialInstance & inst) mutable
+	auto source = Runtime::get().getRenderer().getMaterialSource("animation");
+
+	mat = Runtime::get().getRenderer().newMaterialInstance(source);
+	mat->setProperty(source->getProperty<int32>("tiles"), 2);
+
+	// looked up once here, so the callback only writes the value
+	mat->setUpdateCallback([ time = 0.f, currentTile = source->getProperty<int32>("currentTile") ](
+		MaterialInstance & inst) mutable
 		{
 			time += Runtime::get().getDeltaTime();
 
-			inst.setProperty("currentTile", 3 - int(time * 1 /*fps*/) % 4 /*num frames*/);
+			inst.setProperty(currentTile, 3 - int(time * 1 /*fps*/) % 4 /*num frames*/);
 		});
 
 	mat->setTexture(0, tex);